@@ -23,7 +23,7 @@
 class CBCDState : public CVanillaState
 {
 public:
-    CBCDState(int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CBCDState(int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CBCDState();
 
     //! Converts BF code to manageable token blocks, compressed/optimized if possible
@@ -76,7 +76,7 @@ private:
             isOutputBuf = false;
             bufOutput |= nibble;
 
-            std::cout.put(bufOutput);
+            COutputBuffer::instance().put(bufOutput);
             bufOutput = 0;
         }
     }
@@ -0,0 +1,220 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CBackgroundCompiler.h"
+
+#include <cstdio>
+#include <cerrno>
+
+#include <dlfcn.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+CVanillaState* CBackgroundCompiler::resumed = nullptr;
+
+CBackgroundCompiler::CBackgroundCompiler(CVanillaState& owner)
+: state(owner), cancelled(false), child(0), library(nullptr), entry(nullptr)
+{
+    std::ostringstream output;
+    state.compileResumable(output);
+    source = output.str();
+
+    worker = std::thread(&CBackgroundCompiler::work, this);
+}
+
+CBackgroundCompiler::~CBackgroundCompiler()
+{
+    {
+        std::lock_guard<std::mutex> guard(childLock);
+        cancelled = true;
+        if (child > 0) {
+            kill(-child, SIGKILL);
+        }
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    state.nativeReady = false;
+    if (library) {
+        dlclose(library);
+    }
+}
+
+bool CBackgroundCompiler::wait()
+{
+    if (worker.joinable()) {
+        worker.join();
+    }
+    return state.nativeReady.load(std::memory_order_acquire);
+}
+
+void CBackgroundCompiler::resume()
+{
+    if (!state.nativeReady.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    //! Both sides write to the same stdout, keep what's already been printed in order
+    COutputBuffer::instance().flush();
+    resumed = &state;
+    entry(&state.tape, &state.cellLow, &state.cellCount, &state.curPtrPos, state.IP,
+          &CBackgroundCompiler::growTape, &CBackgroundCompiler::growTapeLeft, &CBackgroundCompiler::readInput, &CBackgroundCompiler::writeOutput,
+          &CBackgroundCompiler::boundsError);
+    resumed = nullptr;
+}
+
+void* CBackgroundCompiler::growTape(void*, int64_t* size, int64_t index)
+{
+    reachIndex(index);
+    *size = resumed->cellCount;
+    return resumed->tape;
+}
+
+void* CBackgroundCompiler::growTapeLeft(void*, int64_t* low, int64_t index)
+{
+    reachIndex(index);
+    *low = resumed->cellLow;
+    return resumed->tape;
+}
+
+void CBackgroundCompiler::reachIndex(int64_t index)
+{
+    try {
+        resumed->examineIndex(index);
+    } catch (std::exception& e) {
+        fail(e);
+    }
+}
+
+void CBackgroundCompiler::boundsError(int up)
+{
+    fail(std::runtime_error(up ? "Pointer was incremented too much." : "Pointer was decremented too much."));
+}
+
+void CBackgroundCompiler::fail(const std::exception& error)
+{
+    COutputBuffer::instance().flush();
+    std::cerr << "Error: " << error.what() << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+int CBackgroundCompiler::readInput()
+{
+    uint8_t c;
+    if (!CInputBuffer::instance().get(c)) {
+        return EOF;
+    }
+    return c;
+}
+
+void CBackgroundCompiler::writeOutput(const char* bytes, int64_t count)
+{
+    COutputBuffer::instance().write(bytes, count);
+}
+
+void CBackgroundCompiler::work()
+{
+    //! gcc going away early shouldn't take the whole process with it, write() reports it just fine
+    sigset_t pipeSignal;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+
+    //! The shared object never touches the disk, it's built straight into memory
+    int libraryFd = memfd_create("bfk", MFD_CLOEXEC);
+    if (libraryFd < 0) {
+        return;
+    }
+    std::string libraryFile = "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(libraryFd);
+
+    if (build(libraryFile)) {
+        library = dlopen(libraryFile.c_str(), RTLD_NOW | RTLD_LOCAL);
+    }
+    close(libraryFd);
+    if (!library) {
+        return;
+    }
+
+    entry = (Entry)dlsym(library, "bfkResume");
+    if (entry) {
+        state.nativeReady.store(true, std::memory_order_release);
+    }
+}
+
+bool CBackgroundCompiler::build(const std::string& libraryFile)
+{
+    int sourcePipe[2];
+    if (pipe(sourcePipe) != 0) {
+        return false;
+    }
+
+    pid_t pid;
+    {
+        std::lock_guard<std::mutex> guard(childLock);
+        if (cancelled) {
+            close(sourcePipe[0]);
+            close(sourcePipe[1]);
+            return false;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            //! Its own group, so killing it takes the compiler proper along too
+            setpgid(0, 0);
+            dup2(sourcePipe[0], STDIN_FILENO);
+            close(sourcePipe[0]);
+            close(sourcePipe[1]);
+            execlp("gcc", "gcc", "-O3", "-w", "-shared", "-fPIC", "-o", libraryFile.c_str(), "-x", "c", "-", (char*)nullptr);
+            _exit(127);
+        }
+        if (pid > 0) {
+            //! Both sides set the group, the destructor may want to kill it before the child got that far
+            setpgid(pid, pid);
+        }
+        child = pid > 0 ? pid : 0;
+    }
+    close(sourcePipe[0]);
+    if (pid < 0) {
+        close(sourcePipe[1]);
+        return false;
+    }
+
+    const char* data = source.data();
+    size_t left = source.size();
+    while (left > 0) {
+        ssize_t written = write(sourcePipe[1], data, left);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+    close(sourcePipe[1]);
+
+    int status;
+    pid_t result;
+    do {
+        result = waitpid(pid, &status, 0);
+    } while (result < 0 && errno == EINTR);
+
+    std::lock_guard<std::mutex> guard(childLock);
+    child = 0;
+    return left == 0 && result == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
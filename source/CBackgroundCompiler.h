@@ -0,0 +1,84 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CBACKGROUND_COMPILER_H
+#define CBACKGROUND_COMPILER_H
+
+#include "CVanillaState.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include <sys/types.h>
+
+//! Builds the translated code with gcc as a shared object while the interpreter keeps going
+//! Once it's loaded, the state's nativeReady flag tells the interpreter to hand over at a loop
+//! Nothing is written to disk, the source goes through a pipe and the library into a memfd
+class CBackgroundCompiler
+{
+public:
+    //! Generates the C source right away, so the worker never touches the state
+    explicit CBackgroundCompiler(CVanillaState& owner);
+    //! Kills gcc if it's still busy, the interpreter has already finished by then
+    ~CBackgroundCompiler();
+
+    //! Blocks until gcc is done, true if the native code can be used
+    bool wait();
+
+    //! Continues natively from the loop at state.IP( or from the start, if IP is 0 )
+    //! with the state's own tape and pointer
+    void resume();
+
+private:
+    typedef void* (*Grow)(void* tape, int64_t* size, int64_t index);
+    typedef int (*Input)();
+    typedef void (*Output)(const char* bytes, int64_t count);
+    typedef void (*Bounds)(int up);
+    typedef void (*Entry)(void** tape, int64_t* low, int64_t* size, int64_t* index, int64_t start, Grow grow, Grow growLeft, Input input, Output output, Bounds bounds);
+
+    CVanillaState& state;
+
+    std::string source;
+
+    std::thread worker;
+    std::mutex childLock; //! Guards 'cancelled' and 'child' against the destructor
+    bool cancelled;
+    pid_t child;
+
+    void* library;
+    Entry entry;
+
+    void work();
+    //! Feeds the source to gcc through a pipe, the shared object ends up at 'libraryFile'
+    bool build(const std::string& libraryFile);
+
+    //! What native code calls instead of realloc(), the tape is grown the interpreter's way
+    static void* growTape(void* tape, int64_t* size, int64_t index);
+    //! Same for a two-way tape growing to the left, 'low' gets the lowest cell available
+    static void* growTapeLeft(void* tape, int64_t* low, int64_t index);
+    static void reachIndex(int64_t index);
+    //! What native code calls once the pointer leaves a fixed tape, 'up' tells which end
+    static void boundsError(int up);
+    //! Ends the program the way bfk does when run() fails
+    static void fail(const std::exception& error);
+    //! What native code calls instead of getchar(), EOF once there's nothing left
+    static int readInput();
+    //! What native code prints through, so it lands in order with what the interpreter printed
+    static void writeOutput(const char* bytes, int64_t count);
+    static CVanillaState* resumed; //! Whose tape growTape() works on
+};
+
+#endif // CBACKGROUND_COMPILER_H
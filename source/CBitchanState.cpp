@@ -17,7 +17,7 @@
 
 #include <cmath>
 
-CBitchanState::CBitchanState(int count, bool wrapPtr, bool dynamicTape, const std::string& dataFile, bool debug)
+CBitchanState::CBitchanState(int64_t count, bool wrapPtr, bool dynamicTape, const std::string& dataFile, bool debug)
 : CVanillaState(1, count, wrapPtr, dynamicTape, RETM1, dataFile, debug)
 {
     if (count < 16) {
@@ -27,9 +27,7 @@ CBitchanState::CBitchanState(int count, bool wrapPtr, bool dynamicTape, const st
     curPtrPos = 16;
 
     //! Doing this to avoid the parent class complaining about cell count
-    cellCount = count/8;
-    tape = realloc(tape, cellCount);
-    memset(tape, 0, cellCount);
+    resizeTape(count/8);
 }
 
 CBitchanState::~CBitchanState()
@@ -47,11 +45,7 @@ void CBitchanState::translate(std::istream& input)
         {
         case '<':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '}':
             instructions.push_back(BFinstr(c));
@@ -69,6 +63,7 @@ void CBitchanState::translate(std::istream& input)
     if (bracesCount != 0) {
         throw std::runtime_error("Opening and closing braces don't match.");
     }
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -76,11 +71,11 @@ void CBitchanState::translate(std::istream& input)
     }
 }
 
-const IBasicState::CellType CBitchanState::getCell(int cellIndex)
+const IBasicState::CellType CBitchanState::getCell(int64_t cellIndex)
 {
-    int sign = (cellIndex >> (sizeof(int)*8 - 1)) & 0x1;
+    int sign = cellIndex < 0;
 
-    int absIndex = (cellIndex - sign*7)/8;
+    int64_t absIndex = (cellIndex - sign*7)/8;
     int relIndex = (cellIndex % 8 + 8) % 8;
 
     CellType toReturn{0};
@@ -90,11 +85,11 @@ const IBasicState::CellType CBitchanState::getCell(int cellIndex)
     return toReturn;
 }
 
-void CBitchanState::setCell(int cellIndex, const CellType& newValue)
+void CBitchanState::setCell(int64_t cellIndex, const CellType& newValue)
 {
-    int sign = (cellIndex >> (sizeof(int)*8 - 1)) & 0x1;
+    int sign = cellIndex < 0;
 
-    int absIndex = (cellIndex - sign*7)/8;
+    int64_t absIndex = (cellIndex - sign*7)/8;
     int relIndex = (cellIndex % 8 + 8) % 8;
 
     CellType temp = CVanillaState::getCell(absIndex);
@@ -109,9 +104,9 @@ void CBitchanState::compilePreInst(std::ostream& output)
     using std::endl;
     using std::max;
 
-    output << "CellType* p = calloc(" << max(cellCount, (int)initData.size()+2) << ", sizeof(CellType));" << endl;
-    output << "int index = 16;" << endl;
-    output << "int size = " << max(cellCount, (int)initData.size()+2) << ';' << endl;
+    output << "CellType* p = allocTape(" << max(cellCount, (int64_t)initData.size()+2) << ");" << endl;
+    output << "int64_t index = 16;" << endl;
+    output << "int64_t size = " << max(cellCount, (int64_t)initData.size()+2) << ';' << endl;
 
     if (!initData.empty()) {
         output << "{" << endl;
@@ -125,12 +120,12 @@ void CBitchanState::compilePreInst(std::ostream& output)
 
 void CBitchanState::runInstruction(const BFinstr& instr)
 {
-    switch (instr.token)
+    switch (instr.op)
     {
-    case '<':
-        curPtrPos -= instr.repeat;
+    case OP_MOVE:
+        curPtrPos += instr.value;
     break;
-    case '}':
+    case OP_EXT: //! '}', the only other command
     {
         CellType temp = getCell(curPtrPos);
         ++temp.c64;
@@ -139,41 +134,23 @@ void CBitchanState::runInstruction(const BFinstr& instr)
         ++curPtrPos;
     }
     break;
-    case '[':
+    case OP_OPEN:
         if (getCell(curPtrPos).c64 == 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                ++IP;
-                char token = getCode(IP).token;
-                if (token == '[') {
-                    ++depth;
-                } else if (token == ']') {
-                    --depth;
-                }
-            }
+            IP = instr.jump;
         }
     break;
-    case ']':
+    case OP_CLOSE:
         if (getCell(curPtrPos).c64 != 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                --IP;
-                char token = getCode(IP).token;
-                if (token == '[') {
-                    --depth;
-                } else if (token == ']') {
-                    ++depth;
-                }
-            }
+            IP = instr.jump;
         }
     break;
+    default:
+    break;
     }
 
     if (getCell(5).c8) {
         if (getCell(7).c8) {
-            std::cout.put((char)((uint8_t*)tape)[1]);
+            COutputBuffer::instance().put((char)((uint8_t*)tape)[1]);
         } else {
             uint8_t c;
             userInput(c);
@@ -198,10 +175,10 @@ void CBitchanState::compileInstruction(std::ostream& output, const BFinstr& inst
 {
     using std::endl;
 
-    switch (instr.token)
+    switch (instr.op)
     {
-    case '<':
-        output << "index -= " << instr.repeat << ';' << endl;
+    case OP_MOVE:
+        output << "index -= " << -instr.value << ';' << endl;
         output << "if (index < 0) {" << endl;
         if (ptrWrap) {
             output << "index = " << cellCount*8 << " + index % " << cellCount*8 << ';' << endl;
@@ -210,7 +187,7 @@ void CBitchanState::compileInstruction(std::ostream& output, const BFinstr& inst
         }
         output << "}" << endl;
     break;
-    case '}':
+    case OP_EXT:
     {
         output << "p[index/8] ^= 0x1 << (index % 8);" << endl;
         if (ptrWrap) {
@@ -228,9 +205,9 @@ void CBitchanState::compileInstruction(std::ostream& output, const BFinstr& inst
 
         output << "if (p[0] & 0x20) {" << endl;
         output << "if (p[0] & 0x80) {" << endl;
-        output << "putchar(p[1]);" << endl;
+        output << "putOutput(p[1]);" << endl;
         output << "} else {" << endl;
-        output << "int temp = getchar();" << endl;
+        output << "int temp = getByte();" << endl;
         output << "if (temp == EOF) {" << endl;
         output << "p[0] |= 0x40;" << endl;
         output << "} else {" << endl;
@@ -242,11 +219,13 @@ void CBitchanState::compileInstruction(std::ostream& output, const BFinstr& inst
         output << "}" << endl;
     }
     break;
-    case '[':
+    case OP_OPEN:
         output << "while (p[index/8] & (0x1 << (index % 8))) {" << endl;
     break;
-    case ']':
+    case OP_CLOSE:
         output << "}" << endl;
     break;
+    default:
+    break;
     }
 }
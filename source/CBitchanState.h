@@ -21,17 +21,20 @@
 class CBitchanState : public CVanillaState
 {
 public:
-    CBitchanState(int count, bool wrapPtr, bool dynamicTape, const std::string& dataFile, bool debug);
+    CBitchanState(int64_t count, bool wrapPtr, bool dynamicTape, const std::string& dataFile, bool debug);
     ~CBitchanState();
 
     void translate(std::istream& input);
 
 protected:
-    const CellType getCell(int cellIndex);
-    void setCell(int cellIndex, const CellType& newValue);
+    const CellType getCell(int64_t cellIndex);
+    void setCell(int64_t cellIndex, const CellType& newValue);
 
     void compilePreInst(std::ostream& output);
 
+    bool hasPlainRuntime() const {
+        return false;
+    }
     void runInstruction(const BFinstr& instr);
     void compileInstruction(std::ostream& output, const BFinstr& instr);
 };
@@ -0,0 +1,129 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CBuildCache.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+CBuildCache::CBuildCache(const std::string& input)
+: key(input)
+{
+    std::string dir;
+    if (input.empty()) {
+        return;
+    }
+    if (const char* xdg = getenv("XDG_CACHE_HOME")) {
+        dir = xdg;
+    } else if (const char* home = getenv("HOME")) {
+        dir = std::string(home) + "/.cache";
+    }
+    if (dir.empty() || !makeDirs(dir + "/bfk")) {
+        return;
+    }
+
+    //! Two FNV-1a passes with different seeds only pick the file, the key stored in it decides whether it's a hit
+    uint64_t hashes[2] = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+    for (uint64_t& hash : hashes) {
+        for (char c : input) {
+            hash ^= (uint8_t)c;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    std::ostringstream name;
+    name << dir << "/bfk/" << std::hex << std::setfill('0');
+    name << std::setw(16) << hashes[0] << std::setw(16) << hashes[1];
+    entry = name.str();
+}
+
+bool CBuildCache::fetch(const std::string& outputFile) const
+{
+    if (entry.empty()) {
+        return false;
+    }
+    std::ifstream cached(entry, std::ios::binary);
+    if (!cached.is_open()) {
+        return false;
+    }
+
+    //! An entry is the key's length, the key itself and then the binary
+    size_t length;
+    if (!(cached >> length) || cached.get() != '\n' || length != key.size()) {
+        return false;
+    }
+    std::string stored(length, '\0');
+    if (!cached.read(&stored[0], length) || stored != key) {
+        return false;
+    }
+
+    //! Always a copy, a hardlink would let whatever happens to the output later reach into the cache
+    remove(outputFile.c_str());
+    std::ofstream output(outputFile, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        return false;
+    }
+    output << cached.rdbuf();
+    output.close();
+    if (!output || chmod(outputFile.c_str(), 0755) != 0) {
+        remove(outputFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+void CBuildCache::store(const std::string& outputFile) const
+{
+    if (entry.empty()) {
+        return;
+    }
+    std::ifstream input(outputFile, std::ios::binary);
+    if (!input.is_open()) {
+        return;
+    }
+
+    //! Renamed into place, so a concurrent fetch never sees half an entry
+    std::string temp = entry + ".tmp" + std::to_string(getpid());
+    std::ofstream output(temp, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        return;
+    }
+    output << key.size() << '\n' << key << input.rdbuf();
+    output.close();
+    if (!output || rename(temp.c_str(), entry.c_str()) != 0) {
+        remove(temp.c_str());
+    }
+}
+
+bool CBuildCache::makeDirs(const std::string& path)
+{
+    for (size_t i = 1; i <= path.size(); i++) {
+        if (i == path.size() || path[i] == '/') {
+            std::string part = path.substr(0, i);
+            if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CBUILD_CACHE_H
+#define CBUILD_CACHE_H
+
+#include <string>
+
+//! On-disk cache of compiled binaries, found by a hash of what went into building them and checked against all of it
+//! Lives in $XDG_CACHE_HOME/bfk( or ~/.cache/bfk ), does nothing if that can't be used
+class CBuildCache
+{
+public:
+    //! 'input' should hold everything the binary depends on, generated code and compiler command
+    //! An empty one turns caching off
+    explicit CBuildCache(const std::string& input);
+
+    //! Puts a cached binary at 'outputFile', false if there's none
+    bool fetch(const std::string& outputFile) const;
+    //! Keeps a copy of a freshly built 'outputFile' for next time
+    void store(const std::string& outputFile) const;
+
+private:
+    std::string key; //! What the binary was built from, kept in the entry and compared on fetch
+    std::string entry; //! Where the binary is or would be cached, empty if caching is off
+
+    static bool makeDirs(const std::string& path);
+};
+
+#endif // CBUILD_CACHE_H
@@ -17,7 +17,7 @@
 
 using namespace std;
 
-CCaretState::CCaretState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const string& dataFile, bool debug)
+CCaretState::CCaretState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug)
 {}
 
@@ -42,11 +42,7 @@ void CCaretState::translate(istream& input)
         case '{':
         case '}':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -75,6 +71,9 @@ void CCaretState::translate(istream& input)
     } else if (parenCount != 0) {
         throw runtime_error("Opening and closing parenthesis don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
+    linkJumps('(', ')');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -86,7 +85,7 @@ void CCaretState::compilePreMain(std::ostream& output)
 {
     CVanillaState::compilePreMain(output);
 
-    output << "CellType* indirectGet(CellType** p, int* size, int index) {" << endl;
+    output << "CellType* indirectGet(CellType** p, int64_t* size, int64_t index, int write) {" << endl;
     output << "if (index < 0) {" << endl;
     if (ptrWrap) {
         output << "index = " << cellCount << " + index % " << cellCount << ';' << endl;
@@ -104,7 +103,11 @@ void CCaretState::compilePreMain(std::ostream& output)
         }
     }
     output << "}" << endl;
-    output << "return (*p + index);" << endl;
+    if (sparse) {
+        output << "return sparseCell(index, write);" << endl;
+    } else {
+        output << "return (*p + index);" << endl;
+    }
     output << "}" << endl;
 }
 
@@ -118,7 +121,7 @@ void CCaretState::runInstruction(const BFinstr& instr)
     {
         CellType ptr = getCell(curPtrPos);
         CellType temp = getCell(ptr.c32);
-        temp.c64 -= instr.repeat;
+        temp.c64 -= instr.value;
         setCell(ptr.c32, temp);
     }
     break;
@@ -126,38 +129,18 @@ void CCaretState::runInstruction(const BFinstr& instr)
     {
         CellType ptr = getCell(curPtrPos);
         CellType temp = getCell(ptr.c32);
-        temp.c64 += instr.repeat;
+        temp.c64 += instr.value;
         setCell(ptr.c32, temp);
     }
     break;
     case '(':
         if (getCell(getCell(curPtrPos).c32).c64 == 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                ++IP;
-                char token = getCode(IP).token;
-                if (token == '(') {
-                    ++depth;
-                } else if (token == ')') {
-                    --depth;
-                }
-            }
+            IP = instr.jump;
         }
     break;
     case ')':
         if (getCell(getCell(curPtrPos).c32).c64 != 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                --IP;
-                char token = getCode(IP).token;
-                if (token == '(') {
-                    --depth;
-                } else if (token == ')') {
-                    ++depth;
-                }
-            }
+            IP = instr.jump;
         }
     break;
     }
@@ -170,13 +153,13 @@ void CCaretState::compileInstruction(std::ostream& output, const BFinstr& instr)
     switch (instr.token)
     {
     case '{':
-        output << "*indirectGet(&p, &size, p[index]) -= " << instr.repeat << ';' << endl;
+        output << "*indirectGet(&p, &size, " << cellAt(0) << ", 1) -= " << instr.value << ';' << endl;
     break;
     case '}':
-        output << "*indirectGet(&p, &size, p[index]) += " << instr.repeat << ';' << endl;
+        output << "*indirectGet(&p, &size, " << cellAt(0) << ", 1) += " << instr.value << ';' << endl;
     break;
     case '(':
-        output << "while (*indirectGet(&p, &size, p[index])) {" << endl;
+        output << "while (*indirectGet(&p, &size, " << cellAt(0) << ", 0)) {" << endl;
     break;
     case ')':
         output << "}" << endl;
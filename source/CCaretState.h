@@ -21,7 +21,7 @@
 class CCaretState : public CVanillaState
 {
 public:
-    CCaretState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CCaretState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CCaretState();
 
     //! Converts BF code to manageable token blocks, compressed/optimized if possible
@@ -29,6 +29,12 @@ public:
 
 private:
     void compilePreMain(std::ostream& output);
+    bool hasPlainRuntime() const {
+        return false;
+    }
+    bool foldsToken(char token) const {
+        return token == '{' || token == '}';
+    }
     void runInstruction(const BFinstr& instr);
     void compileInstruction(std::ostream& output, const BFinstr& instr);
 };
@@ -15,7 +15,7 @@
 
 #include "CCompressedState.h"
 
-CCompressedState::CCompressedState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+CCompressedState::CCompressedState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug), bufCmd(0), bufBits(0)
 {}
 
@@ -41,11 +41,7 @@ void CCompressedState::translate(std::istream& input)
         case '+':
         case '-':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -64,6 +60,8 @@ void CCompressedState::translate(std::istream& input)
     if (bracesCount != 0) {
         throw std::runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
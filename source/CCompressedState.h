@@ -21,7 +21,7 @@
 class CCompressedState : public CVanillaState
 {
 public:
-    CCompressedState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CCompressedState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CCompressedState();
 
     void translate(std::istream& input);
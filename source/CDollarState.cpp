@@ -17,7 +17,7 @@
 
 using namespace std;
 
-CDollarState::CDollarState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const string& dataFile, bool debug)
+CDollarState::CDollarState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug)
 {}
 
@@ -40,11 +40,7 @@ void CDollarState::translate(istream& input)
         case '+':
         case '-':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -77,17 +73,49 @@ void CDollarState::translate(istream& input)
     } else if (parenCount != 0) {
         throw runtime_error("Opening and closing parenthesis don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
+    linkJumps('(', ')');
 }
 
 void CDollarState::compilePreMain(std::ostream& output)
 {
+    output << "#include <ctype.h>" << endl;
     output << "#include <inttypes.h>" << endl;
 
     CVanillaState::compilePreMain(output);
 
+    //! Same as scanf("%u"), only on top of the buffered input
+    output << "int scanNumber(CellType* dst) {" << endl;
+    output << "int c, negative = 0;" << endl;
+    output << "CellType value = 0;" << endl;
+    output << "while ((c = peekByte()) != EOF && isspace(c)) {" << endl;
+    output << "getByte();" << endl;
+    output << "}" << endl;
+    output << "if (c == '+' || c == '-') {" << endl;
+    output << "negative = c == '-';" << endl;
+    output << "getByte();" << endl;
+    output << "c = peekByte();" << endl;
+    output << "}" << endl;
+    output << "if (c == EOF) {" << endl;
+    output << "return EOF;" << endl;
+    output << "}" << endl;
+    output << "if (!isdigit(c)) {" << endl;
+    output << "return 0;" << endl;
+    output << "}" << endl;
+    output << "while ((c = peekByte()) != EOF && isdigit(c)) {" << endl;
+    output << "value = value*10 + (getByte() - '0');" << endl;
+    output << "}" << endl;
+    output << "*dst = negative ? -value : value;" << endl;
+    output << "return 1;" << endl;
+    output << "}" << endl;
+
     output << "void* pushStack(CellType* p, int* size, int* index, CellType newVal) {" << endl;
     output << "++*index;" << endl;
     output << "if (*index == *size) {" << endl;
+    if (budgeted()) {
+        output << "chargeMemory(&stackAccount, \"stack\", (*size + 1)*sizeof(CellType));" << endl;
+    }
     output << "p = realloc(p, (++*size)*sizeof(CellType));" << endl;
     output << "if (!p) {" << endl;
     output << "fputs(\"Out of memory!\\n\", stderr);" << endl;
@@ -156,7 +184,7 @@ void CDollarState::runInstruction(const BFinstr& instr)
     switch (instr.token)
     {
     case '#':
-        cellStack.push_back(getCell(curPtrPos));
+        pushStack(cellStack, getCell(curPtrPos));
     break;
     case '$':
         if (!cellStack.empty()) {
@@ -166,13 +194,14 @@ void CDollarState::runInstruction(const BFinstr& instr)
     case ':':
     {
         CellType temp = getCell(curPtrPos);
-        cout << temp.c64;
+        std::string text = std::to_string(temp.c64);
+        COutputBuffer::instance().write(text.data(), text.size());
     }
     break;
     case ';':
     {
         CellType temp = getCell(curPtrPos);
-        if (!(cin >> temp.c64)) {
+        if (!CInputBuffer::instance().getNumber(temp.c64)) {
             switch (eofPolicy)
             {
             case IBasicState::RETM1:
@@ -193,36 +222,17 @@ void CDollarState::runInstruction(const BFinstr& instr)
     }
     break;
     case '(':
-        getCode(IP).repeat = cellStack.back().c32 & 0x7FFFFFFF;
-        if (getCode(IP).repeat == 0) {
-            int depth = 1;
-            while (depth > 0) {
-                ++IP;
-                char token = getCode(IP).token;
-                if (token == '(') {
-                    ++depth;
-                } else if (token == ')') {
-                    --depth;
-                }
-            }
+        getCode(IP).value = cellStack.back().c32 & 0x7FFFFFFF;
+        if (getCode(IP).value == 0) {
+            IP = instr.jump;
         }
     break;
     case ')':
     {
-        int depth = 1;
         int startIP = IP;
 
-        while (depth > 0) {
-            --IP;
-            char token = getCode(IP).token;
-            if (token == '(') {
-                --depth;
-            } else if (token == ')') {
-                ++depth;
-            }
-        }
-
-        if (--instructions[IP].repeat <= 0) {
+        IP = instr.jump;
+        if (--instructions[IP].value <= 0) {
             IP = startIP;
         }
     }
@@ -243,11 +253,14 @@ void CDollarState::compileInstruction(std::ostream& output, const BFinstr& instr
         output << "p[index] = popStack(pS, &sIndex);" << endl;
     break;
     case ':':
-        output << "printf(\"%\" PRIu" << cellSize*8 << ", p[index]);" << endl;
+        output << "{" << endl;
+        output << "char text[24];" << endl;
+        output << "writeOutput(text, sprintf(text, \"%\" PRIu" << cellSize*8 << ", p[index]));" << endl;
+        output << "}" << endl;
     break;
     case ';':
-        output << "while (scanf(\"%\" SCNu" << cellSize*8 << ", &p[index]) != 1) {" << endl;
-        output << "(void) getchar();" << endl;
+        output << "while (scanNumber(&p[index]) != 1) {" << endl;
+        output << "(void) getByte();" << endl;
         output << "}" << endl;
     break;
     case '(':
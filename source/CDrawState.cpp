@@ -19,7 +19,7 @@
 
 #include <signal.h>
 
-CDrawState::CDrawState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+CDrawState::CDrawState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug),
   R(0), G(0), B(0), X(0), Y(0), outimg(256, 256)
 {
@@ -60,11 +60,7 @@ void CDrawState::translate(std::istream& input)
         case 'e':
         case 'w':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -83,6 +79,8 @@ void CDrawState::translate(std::istream& input)
     if (bracesCount != 0) {
         throw std::runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -97,94 +95,46 @@ void CDrawState::compile(std::ostream&)
 
 void CDrawState::runInstruction(const BFinstr& instr)
 {
-    switch (instr.token)
-    {
-    case '>':
-        curPtrPos += instr.repeat;
-    break;
-    case '<':
-        curPtrPos -= instr.repeat;
-    break;
-    case '+':
-    {
-        CellType temp = getCell(curPtrPos);
-        temp.c64 += instr.repeat;
-        setCell(curPtrPos, temp);
-    }
-    break;
-    case '-':
+    switch (instr.op)
     {
-        CellType temp = getCell(curPtrPos);
-        temp.c64 -= instr.repeat;
-        setCell(curPtrPos, temp);
-    }
-    break;
-    case '.':
+    case OP_OUT:
         outimg.set_pixel(X, Y, png::basic_rgb_pixel<uint8_t>(R, G, B));
     break;
-    case ',':
-    {
-        CellType temp = getCell(curPtrPos);
-        userInput(temp.c8);
-        setCell(curPtrPos, temp);
-    }
-    break;
-    case '[':
-        if (getCell(curPtrPos).c64 == 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                ++IP;
-                char token = getCode(IP).token;
-                if (token == '[') {
-                    ++depth;
-                } else if (token == ']') {
-                    --depth;
-                }
-            }
-        }
-    break;
-    case ']':
-        if (getCell(curPtrPos).c64 != 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                --IP;
-                char token = getCode(IP).token;
-                if (token == '[') {
-                    --depth;
-                } else if (token == ']') {
-                    ++depth;
-                }
-            }
+    case OP_EXT:
+        switch (instr.token)
+        {
+        case 'r':
+            R = getCell(curPtrPos).c8;
+        break;
+        case 'g':
+            G = getCell(curPtrPos).c8;
+        break;
+        case 'b':
+            B = getCell(curPtrPos).c8;
+        break;
+        case 'x':
+            X = getCell(curPtrPos).c8;
+        break;
+        case 'y':
+            Y = getCell(curPtrPos).c8;
+        break;
+        case 'n':
+            Y -= instr.value;
+        break;
+        case 's':
+            Y += instr.value;
+        break;
+        case 'e':
+            X += instr.value;
+        break;
+        case 'w':
+            X -= instr.value;
+        break;
         }
     break;
-    case 'r':
-        R = getCell(curPtrPos).c8;
-    break;
-    case 'g':
-        G = getCell(curPtrPos).c8;
-    break;
-    case 'b':
-        B = getCell(curPtrPos).c8;
-    break;
-    case 'x':
-        X = getCell(curPtrPos).c8;
-    break;
-    case 'y':
-        Y = getCell(curPtrPos).c8;
-    break;
-    case 'n':
-        Y -= instr.repeat;
-    break;
-    case 's':
-        Y += instr.repeat;
-    break;
-    case 'e':
-        X += instr.repeat;
-    break;
-    case 'w':
-        X -= instr.repeat;
+    default:
+        //! Everything else behaves exactly like vanilla
+        CVanillaState::runInstruction(instr);
     break;
     }
 
@@ -208,11 +158,7 @@ void CDrawState::runDebug()
             cout << "Current Pointer : " << curPtrPos << endl;
             cout << "Current Color   : (" << (int)R << ", " << (int)G << ", " << (int)B << ")" << endl;
             cout << "Current Pixel   : (" << (int)X << ", " << (int)Y << ")" << endl;
-            cout << "Next instruction: " << tempCode.token;
-            if (tempCode.repeat > 1) {
-                cout << " x" << tempCode.repeat;
-            }
-            cout << endl;
+            cout << "Next instruction: " << describe(tempCode) << endl;
 
             char choice;
             cout << "What to do ( h ): ";
@@ -22,7 +22,7 @@
 class CDrawState : public CVanillaState
 {
 public:
-    CDrawState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CDrawState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CDrawState();
 
     void translate(std::istream& input);
@@ -34,6 +34,12 @@ protected:
     uint8_t X, Y;
     png::image<png::rgb_pixel> outimg;
 
+    bool hasPlainRuntime() const {
+        return false;
+    }
+    bool foldsToken(char token) const {
+        return std::string("rgbxynsew").find(token) != std::string::npos;
+    }
     void runInstruction(const BFinstr& instr);
     void runDebug();
 };
@@ -91,11 +91,7 @@ void CExtLollerState::translate(std::istream& input)
             case '{':
             case '}':
                 //! A way to "optimize"/compress BF code, add many consecutive commands together
-                if (!instructions.empty() && instructions.back().token == c) {
-                    instructions.back().incr();
-                } else {
-                    instructions.push_back(BFinstr(c));
-                }
+                pushInstr(BFinstr(c));
             break;
             case '.':
             case ',':
@@ -145,6 +141,8 @@ void CExtLollerState::translate(std::istream& input)
     if (bracesCount != 0) {
         throw std::runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -97,7 +97,7 @@ void CExtended2State::runInstruction(const BFinstr& instr)
     case '.':
     {
         CellType temp = getCell(curPtrPos);
-        cout.put(temp.c8);
+        COutputBuffer::instance().put(temp.c8);
     }
     break;
     case ',':
@@ -212,7 +212,7 @@ void CExtended2State::runInstruction(const BFinstr& instr)
         IP = curPtrPos - 1;
     break;
     case '(':
-        for (int i = curPtrPos; i < cellCount-1; i++) {
+        for (int64_t i = curPtrPos; i < cellCount-1; i++) {
             setCell(i, getCell(i+1));
         }
     break;
@@ -220,7 +220,7 @@ void CExtended2State::runInstruction(const BFinstr& instr)
     {
         //! Avoids lengthening the tape if it doesn't have to
         CellType temp = getCell(cellCount-1);
-        int i = cellCount;
+        int64_t i = cellCount;
         if (temp.c64 == 0) {
             --i;
         }
@@ -273,8 +273,7 @@ void CExtended2State::runInstruction(const BFinstr& instr)
 CVanillaState::BFinstr& CExtended2State::getCode(int ip)
 {
     static BFinstr localTemp(0);
-    localTemp.token = getCell(ip).c8;
-    localTemp.repeat = 1;
+    localTemp = BFinstr(getCell(ip).c8);
 
     return localTemp;
 }
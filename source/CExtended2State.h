@@ -33,6 +33,9 @@ public:
 protected:
     int storagePos;
 
+    bool hasPlainRuntime() const {
+        return false;
+    }
     void runInstruction(const BFinstr& instr);
     BFinstr& getCode(int ip);
 
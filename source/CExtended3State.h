@@ -33,10 +33,10 @@ public:
     void compile(std::ostream& output);
 
 protected:
-    int initPtrPos; //! Because of 'x' command, it needs to remember this
+    int64_t initPtrPos; //! Because of 'x' command, it needs to remember this
 
     std::map<int, bool> lockMap; //! It also allows for setting read-only memory
-    std::vector<int> prevPtrs; //! Stack for saving curPtrPos, for use with 'X' command
+    std::vector<int64_t> prevPtrs; //! Stack for saving curPtrPos, for use with 'X' command
 
     bool isLocked(int cellIndex) {
         auto iter = lockMap.find(cellIndex);
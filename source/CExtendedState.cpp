@@ -43,11 +43,7 @@ void CExtendedState::translate(istream& input)
         case '}':
         case '{':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -73,6 +69,8 @@ void CExtendedState::translate(istream& input)
     if (bracesCount != 0) {
         throw runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -104,14 +102,14 @@ void CExtendedState::runInstruction(const BFinstr& instr)
     case '{':
     {
         CellType temp = getCell(curPtrPos);
-        temp.c64 <<= instr.repeat;
+        temp.c64 <<= instr.value;
         setCell(curPtrPos, temp);
     }
     break;
     case '}':
     {
         CellType temp = getCell(curPtrPos);
-        temp.c64 >>= instr.repeat;
+        temp.c64 >>= instr.value;
         setCell(curPtrPos, temp);
     }
     break;
@@ -148,7 +146,6 @@ void CExtendedState::runInstruction(const BFinstr& instr)
 
 void CExtendedState::compileInstruction(std::ostream& output, const BFinstr& instr)
 {
-    int repeat = instr.repeat;
     switch (instr.token)
     {
     case '@':
@@ -161,10 +158,10 @@ void CExtendedState::compileInstruction(std::ostream& output, const BFinstr& ins
         output << "p[index] = storage;" << endl;
     break;
     case '{':
-        output << "p[index] <<= " << repeat << ';' << endl;
+        output << "p[index] <<= " << instr.value << ';' << endl;
     break;
     case '}':
-        output << "p[index] >>= " << repeat << ';' << endl;
+        output << "p[index] >>= " << instr.value << ';' << endl;
     break;
     case '~':
         output << "p[index] = ~p[index];" << endl;
@@ -195,11 +192,7 @@ void CExtendedState::runDebug()
             cout << "Current IP      : " << IP << endl;
             cout << "Current Pointer : " << curPtrPos << endl;
             cout << "Current Storage : " << getStorage().c64 << endl;
-            cout << "Next instruction: " << tempCode.token;
-            if (tempCode.repeat > 1) {
-                cout << " x" << tempCode.repeat;
-            }
-            cout << endl;
+            cout << "Next instruction: " << describe(tempCode) << endl;
 
             char choice;
             cout << "What to do ( h ): ";
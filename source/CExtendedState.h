@@ -31,6 +31,12 @@ protected:
     CellType storage; //! Extra storage cell required by Extended Type I
 
     void compilePreInst(std::ostream& output);
+    bool hasPlainRuntime() const {
+        return false;
+    }
+    bool foldsToken(char token) const {
+        return token == '{' || token == '}';
+    }
     void runInstruction(const BFinstr& instr);
     void compileInstruction(std::ostream& output, const BFinstr& instr);
 
@@ -0,0 +1,158 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "CInputBuffer.h"
+#include "COutputBuffer.h"
+
+#include <cctype>
+#include <cerrno>
+#include <iostream>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+CInputBuffer::~CInputBuffer()
+{
+    if (mapped) {
+        munmap(mapped, mappedSize);
+    }
+}
+
+bool CInputBuffer::getNumber(uint64_t& value)
+{
+    if (streams) {
+        COutputBuffer::instance().flush();
+        return (bool)(std::cin >> value);
+    }
+
+    uint8_t c;
+    do {
+        if (!get(c)) {
+            return false;
+        }
+    } while (isspace(c));
+
+    bool negative = c == '-';
+    if ((c == '+' || c == '-') && !get(c)) {
+        return false;
+    }
+    if (!isdigit(c)) {
+        return fail();
+    }
+
+    //! Every digit is used up even past an overflow, which then fails too
+    uint64_t result = 0;
+    bool overflow = false;
+    for (;;) {
+        unsigned digit = c - '0';
+        if (result > (UINT64_MAX - digit)/10) {
+            overflow = true;
+        } else {
+            result = result*10 + digit;
+        }
+        if ((next == end && !refill()) || !isdigit(*next)) {
+            break;
+        }
+        c = *next++;
+    }
+    if (overflow) {
+        return fail();
+    }
+    //! Same as std::cin, a negative number wraps around
+    value = negative ? -result : result;
+    return true;
+}
+
+bool CInputBuffer::fail()
+{
+    next = end;
+    atEOF = true;
+    return false;
+}
+
+bool CInputBuffer::refill()
+{
+    if (atEOF) {
+        return false;
+    }
+
+    if (streams) {
+        COutputBuffer::instance().flush();
+        char c;
+        if (!std::cin.get(c)) {
+            atEOF = true;
+            return false;
+        }
+        data[0] = c;
+        next = data;
+        end = data + 1;
+        return true;
+    }
+
+    if (!probed) {
+        probed = true;
+        if (mapInput()) {
+            return true;
+        }
+    }
+
+    //! Whatever was printed so far may well be a prompt
+    COutputBuffer::instance().flush();
+    for (;;) {
+        ssize_t got = read(STDIN_FILENO, data, bufferSize);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            atEOF = true;
+            return false;
+        }
+        next = data;
+        end = data + got;
+        return true;
+    }
+}
+
+bool CInputBuffer::mapInput()
+{
+    struct stat info;
+    if (fstat(STDIN_FILENO, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    //! Something may have read part of the file already, mappings have to start on a page
+    off_t start = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (start < 0 || start >= info.st_size) {
+        return false;
+    }
+    off_t aligned = start - start % sysconf(_SC_PAGESIZE);
+    size_t length = info.st_size - aligned;
+
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, STDIN_FILENO, aligned);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    madvise(p, length, MADV_SEQUENTIAL);
+    //! Anything appended later is read as usual, from where the mapping ends
+    lseek(STDIN_FILENO, info.st_size, SEEK_SET);
+
+    mapped = p;
+    mappedSize = length;
+    next = (const uint8_t*)p + (start - aligned);
+    end = (const uint8_t*)p + length;
+    return true;
+}
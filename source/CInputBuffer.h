@@ -0,0 +1,88 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef CINPUT_BUFFER_H
+#define CINPUT_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! Reads stdin in big chunks with read(2), or maps it whole when it's a regular file, instead of going through std::cin per character
+//! Whatever was printed is flushed right before it would have to wait for more
+class CInputBuffer
+{
+public:
+    //! Shared by every state, there's only one stdin
+    static CInputBuffer& instance() {
+        static CInputBuffer buffer;
+        return buffer;
+    }
+
+    //! False once there's nothing left, and from then on
+    bool get(uint8_t& c) {
+        if (next == end && !refill()) {
+            return false;
+        }
+        c = *next++;
+        return true;
+    }
+    //! Whatever was read ahead already, reading more first if that's nothing, 0 only at EOF
+    //! Nothing is used up until consume() says so
+    size_t available(const uint8_t*& bytes) {
+        if (next == end && !refill()) {
+            return 0;
+        }
+        bytes = next;
+        return end - next;
+    }
+    void consume(size_t count) {
+        next += count;
+    }
+    //! Reads a decimal number the way std::cin >> does, false if there's none or it doesn't fit
+    //! Like std::cin's failbit, a failed read leaves nothing for any read after it
+    bool getNumber(uint64_t& value);
+
+    //! The debugger reads its commands through std::cin, so input has to come from there as well
+    void useStreams() {
+        streams = true;
+    }
+
+private:
+    CInputBuffer(): next(data), end(data), mapped(nullptr), mappedSize(0), streams(false), probed(false), atEOF(false) {}
+    ~CInputBuffer();
+
+    //! Gets more input into 'next' up to 'end', false at EOF
+    bool refill();
+    //! Ends all input for good, returns false for getNumber()
+    bool fail();
+    //! Maps what's left of stdin, if it's a regular file
+    bool mapInput();
+
+    static const size_t bufferSize = (size_t)1 << 16;
+    uint8_t data[bufferSize];
+    const uint8_t* next;
+    const uint8_t* end;
+
+    void* mapped;
+    size_t mappedSize;
+
+    bool streams;
+    bool probed; //! Whether mapInput() was tried already
+    bool atEOF;
+};
+
+#endif // CINPUT_BUFFER_H
@@ -0,0 +1,406 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CJitCompiler.h"
+
+#include <sys/mman.h>
+
+//! Register usage of the generated code:
+//! rbx = tape, r12 = Context*, r13 = pointer, r14 = cell count, r15 = scratch
+//! All of them survive helper calls, rax/rcx/rdx/rsi/rdi don't
+enum Reg { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, RDI = 7, R15 = 15 };
+
+CJitCompiler::CJitCompiler(CVanillaState& owner)
+: state(owner), buffer(nullptr), bufferSize(0), failLabel(0)
+{
+#ifndef __x86_64__
+    throw std::runtime_error("The JIT compiler only supports x86-64.");
+#endif
+
+    translate();
+
+    bufferSize = code.size();
+    buffer = mmap(nullptr, bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        buffer = nullptr;
+        throw std::runtime_error("There's not enough memory available!");
+    }
+    memcpy(buffer, code.data(), bufferSize);
+    //! Never writable and executable at the same time
+    if (mprotect(buffer, bufferSize, PROT_READ | PROT_EXEC) != 0) {
+        munmap(buffer, bufferSize);
+        buffer = nullptr;
+        throw std::runtime_error("Unable to make JIT compiled code executable.");
+    }
+}
+
+CJitCompiler::~CJitCompiler()
+{
+    if (buffer) {
+        munmap(buffer, bufferSize);
+    }
+}
+
+void CJitCompiler::run()
+{
+    Context ctx = { nullptr, 0, state.curPtrPos - state.cellLow, this, 0 };
+    updateContext(&ctx);
+
+    int64_t (*entry)(Context*) = (int64_t (*)(Context*))buffer;
+    int64_t failed = entry(&ctx);
+
+    state.curPtrPos = ctx.ptr + state.cellLow;
+
+    if (failed) {
+        throw std::runtime_error(error);
+    }
+}
+
+void CJitCompiler::emit8(uint8_t byte)
+{
+    code.push_back(byte);
+}
+
+void CJitCompiler::emit32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        emit8(value >> i*8);
+    }
+}
+
+void CJitCompiler::emit64(uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        emit8(value >> i*8);
+    }
+}
+
+void CJitCompiler::patch32(size_t where, size_t target)
+{
+    uint32_t rel = target - (where + 4);
+    for (int i = 0; i < 4; i++) {
+        code[where + i] = rel >> i*8;
+    }
+}
+
+void CJitCompiler::emitFailCheck()
+{
+    emit8(0x0F); emit8(0x88); //! js failLabel
+    emit32(0);
+    patch32(code.size() - 4, failLabel);
+}
+
+void CJitCompiler::emitCall(const void* helper)
+{
+    emit8(0x4C); emit8(0x89); emit8(0xE7); //! mov rdi, r12
+    emit8(0x48); emit8(0xB8);              //! mov rax, helper
+    emit64((uint64_t)helper);
+    emit8(0xFF); emit8(0xD0);              //! call rax
+}
+
+void CJitCompiler::emitReload()
+{
+    emit8(0x49); emit8(0x8B); emit8(0x1C); emit8(0x24);              //! mov rbx, [r12]
+    emit8(0x4D); emit8(0x8B); emit8(0x74); emit8(0x24); emit8(0x08); //! mov r14, [r12+8]
+}
+
+void CJitCompiler::emitReach(int offset)
+{
+    emit8(0x49); emit8(0x8D); emit8(0x85); //! lea rax, [r13+offset]
+    emit32(offset);
+    emit8(0x4C); emit8(0x39); emit8(0xF0); //! cmp rax, r14
+    //! Anything below the cell count is fine as is, negatives included thanks to 'jb'
+    emit8(0x72);                           //! jb reached
+    size_t skip = code.size();
+    emit8(0);
+
+    emit8(0x48); emit8(0x89); emit8(0xC6); //! mov rsi, rax
+    emitCall((const void*)&CJitCompiler::reachCell);
+    emit8(0x48); emit8(0x85); emit8(0xC0); //! test rax, rax
+    emitFailCheck();
+    emitReload();
+    if (state.twoWay) {
+        emit8(0x4D); emit8(0x03); emit8(0x6C); emit8(0x24); emit8(0x20); //! add r13, [r12+32]
+    }
+
+    code[skip] = code.size() - (skip + 1);
+}
+
+void CJitCompiler::emitMove(int64_t amount)
+{
+    if (amount == (int32_t)amount) {
+        emit8(0x49); emit8(0x81); emit8(0xC5); //! add r13, amount
+        emit32(amount);
+    } else {
+        emit8(0x48); emit8(0xB8);              //! mov rax, amount
+        emit64(amount);
+        emit8(0x49); emit8(0x01); emit8(0xC5); //! add r13, rax
+    }
+
+    //! Like the interpreter, only a wrapping pointer gets fixed as it moves
+    if (!state.ptrWrap) {
+        return;
+    }
+
+    emit8(0x4D); emit8(0x39); emit8(0xF5); //! cmp r13, r14
+    emit8(0x72);                           //! jb moved
+    size_t skip = code.size();
+    emit8(0);
+
+    emit8(0x4C); emit8(0x89); emit8(0xEE); //! mov rsi, r13
+    emitCall((const void*)&CJitCompiler::reachCell);
+    emit8(0x48); emit8(0x85); emit8(0xC0); //! test rax, rax
+    emitFailCheck();
+    emit8(0x49); emit8(0x89); emit8(0xC5); //! mov r13, rax
+    emitReload();
+
+    code[skip] = code.size() - (skip + 1);
+}
+
+void CJitCompiler::emitCellOp(uint8_t opByte, uint8_t opWide, int reg)
+{
+    uint8_t rex = reg >= 8 ? 0x44 : 0x00;
+
+    if (state.cellSize == 2) {
+        emit8(0x66);
+    } else if (state.cellSize == 8) {
+        rex |= 0x48;
+    }
+    if (rex) {
+        emit8(rex);
+    }
+    emit8(state.cellSize == 1 ? opByte : opWide);
+    emit8(((reg & 7) << 3) | 0x04);
+    emit8(cellSIB());
+}
+
+uint8_t CJitCompiler::cellSIB() const
+{
+    uint8_t scale = 0;
+    while ((1 << scale) < state.cellSize) {
+        ++scale;
+    }
+    return (scale << 6) | (RAX << 3) | RBX; //! [rbx + rax*cellSize]
+}
+
+void CJitCompiler::translate()
+{
+    std::vector<size_t> opened; //! Where each unmatched '[' keeps its jump, to fix it up later
+
+    code.clear();
+
+    emit8(0x53);               //! push rbx
+    emit8(0x41); emit8(0x54);  //! push r12
+    emit8(0x41); emit8(0x55);  //! push r13
+    emit8(0x41); emit8(0x56);  //! push r14
+    emit8(0x41); emit8(0x57);  //! push r15
+    emit8(0x49); emit8(0x89); emit8(0xFC); //! mov r12, rdi
+    emitReload();
+    emit8(0x4D); emit8(0x8B); emit8(0x6C); emit8(0x24); emit8(0x10); //! mov r13, [r12+16]
+
+    emit8(0xE9); //! jmp body
+    size_t body = code.size();
+    emit32(0);
+
+    //! Shared exit, both for failure( eax = 1 ) and for reaching the end( eax = 0 )
+    failLabel = code.size();
+    emit8(0xB8); emit32(1);    //! mov eax, 1
+    size_t exitLabel = code.size();
+    emit8(0x4D); emit8(0x89); emit8(0x6C); emit8(0x24); emit8(0x10); //! mov [r12+16], r13
+    emit8(0x41); emit8(0x5F);  //! pop r15
+    emit8(0x41); emit8(0x5E);  //! pop r14
+    emit8(0x41); emit8(0x5D);  //! pop r13
+    emit8(0x41); emit8(0x5C);  //! pop r12
+    emit8(0x5B);               //! pop rbx
+    emit8(0xC3);               //! ret
+
+    patch32(body, code.size());
+
+    for (const BFinstr& instr : state.instructions) {
+        switch (instr.op)
+        {
+        case CVanillaState::OP_ADD:
+            emitReach(instr.offset);
+            emit8(0x48); emit8(0xB9); emit64(instr.value); //! mov rcx, value
+            emitCellOp(0x00, 0x01, RCX);                   //! add cell, rcx
+        break;
+        case CVanillaState::OP_SET:
+            emitReach(instr.offset);
+            emit8(0x48); emit8(0xB9); emit64(instr.value); //! mov rcx, value
+            emitCellOp(0x88, 0x89, RCX);                   //! mov cell, rcx
+        break;
+        case CVanillaState::OP_MOVE:
+            emitMove(instr.value);
+        break;
+        case CVanillaState::OP_OUT:
+            emitReach(instr.offset);
+            //! Little endian, the lowest byte is always at the start of the cell
+            emit8(0x0F); emit8(0xB6); //! movzx esi, byte cell
+            emit8((RSI << 3) | 0x04);
+            emit8(cellSIB());
+            emit8(0x48); emit8(0xBA); emit64(instr.value); //! mov rdx, value
+            emitCall((const void*)&CJitCompiler::putCell);
+        break;
+        case CVanillaState::OP_IN:
+            emitReach(instr.offset);
+            emit8(0x48); emit8(0x89); emit8(0xC6); //! mov rsi, rax
+            emitCall((const void*)&CJitCompiler::getCell);
+            emit8(0x48); emit8(0x85); emit8(0xC0); //! test rax, rax
+            emitFailCheck();
+        break;
+        case CVanillaState::OP_COPY:
+        case CVanillaState::OP_SKIP:
+            emitReach(instr.offset);
+            emit8(0x48); emit8(0x89); emit8(0xC6);                                   //! mov rsi, rax
+            emit8(0x48); emit8(0xBA); emit64(instr.value);                           //! mov rdx, value
+            emit8(0x48); emit8(0xB9); emit64(instr.op == CVanillaState::OP_COPY);    //! mov rcx, echo
+            emitCall((const void*)&CJitCompiler::feedCell);
+        break;
+        case CVanillaState::OP_OPEN:
+            emitReach(0);
+            emitCellOp(0x80, 0x83, 7); emit8(0); //! cmp cell, 0
+            emit8(0x0F); emit8(0x84);            //! je past the matching ']'
+            opened.push_back(code.size());
+            emit32(0);
+        break;
+        case CVanillaState::OP_CLOSE:
+        {
+            size_t open = opened.back();
+            opened.pop_back();
+
+            emitReach(0);
+            emitCellOp(0x80, 0x83, 7); emit8(0); //! cmp cell, 0
+            emit8(0x0F); emit8(0x85);            //! jne past the matching '['
+            emit32(0);
+            patch32(code.size() - 4, open + 4);
+            patch32(open, code.size());
+        }
+        break;
+        case CVanillaState::OP_SCAN:
+        {
+            size_t loop = code.size();
+            emitReach(0);
+            emitCellOp(0x80, 0x83, 7); emit8(0); //! cmp cell, 0
+            emit8(0x0F); emit8(0x84);            //! je done
+            size_t done = code.size();
+            emit32(0);
+            emitMove(instr.value);
+            emit8(0xE9);                         //! jmp loop
+            emit32(0);
+            patch32(code.size() - 4, loop);
+            patch32(done, code.size());
+        }
+        break;
+        case CVanillaState::OP_MULADD:
+        {
+            emitReach(instr.source);
+            //! Zero extended, so the whole register can be tested
+            switch (state.cellSize)
+            {
+            case 1:
+                emit8(0x0F); emit8(0xB6); //! movzx ecx, byte cell
+            break;
+            case 2:
+                emit8(0x0F); emit8(0xB7); //! movzx ecx, word cell
+            break;
+            case 4:
+                emit8(0x8B);              //! mov ecx, cell
+            break;
+            case 8:
+                emit8(0x48); emit8(0x8B); //! mov rcx, cell
+            break;
+            }
+            emit8((RCX << 3) | 0x04);
+            emit8(cellSIB());
+            emit8(0x48); emit8(0x85); emit8(0xC9); //! test rcx, rcx
+            emit8(0x0F); emit8(0x84);              //! jz skip
+            size_t skip = code.size();
+            emit32(0);
+            emit8(0x48); emit8(0xBA); emit64(instr.value);   //! mov rdx, value
+            emit8(0x48); emit8(0x0F); emit8(0xAF); emit8(0xCA); //! imul rcx, rdx
+            emit8(0x49); emit8(0x89); emit8(0xCF);           //! mov r15, rcx
+            emitReach(instr.offset);
+            emitCellOp(0x00, 0x01, R15);                     //! add cell, r15
+            patch32(skip, code.size());
+        }
+        break;
+        default:
+        break;
+        }
+    }
+
+    emit8(0x31); emit8(0xC0); //! xor eax, eax
+    emit8(0xE9);              //! jmp exitLabel
+    emit32(0);
+    patch32(code.size() - 4, exitLabel);
+}
+
+int64_t CJitCompiler::reachCell(Context* ctx, int64_t index)
+{
+    CVanillaState& state = ctx->jit->state;
+    int64_t oldLow = state.cellLow;
+    int64_t cellIndex = index + oldLow;
+
+    try {
+        //! Bounds, wrapping and growth are all up to the state's own policy
+        state.examineIndex(cellIndex);
+    } catch (std::exception& e) {
+        ctx->jit->error = e.what();
+        return -1;
+    }
+
+    ctx->shift = oldLow - state.cellLow;
+    updateContext(ctx);
+    return cellIndex - state.cellLow;
+}
+
+void CJitCompiler::updateContext(Context* ctx)
+{
+    CVanillaState& state = ctx->jit->state;
+
+    ctx->tape = (uint8_t*)state.tape + state.cellLow*state.cellSize;
+    ctx->count = state.cellCount - state.cellLow;
+}
+
+void CJitCompiler::putCell(Context*, int64_t c, int64_t count)
+{
+    COutputBuffer::instance().fill((char)c, count);
+}
+
+void CJitCompiler::feedCell(Context* ctx, int64_t index, int64_t value, int64_t echo)
+{
+    CVanillaState& state = ctx->jit->state;
+    uint8_t* cell = (uint8_t*)ctx->tape + index*state.cellSize;
+
+    *cell = state.feedLoop(*cell, value, echo);
+}
+
+int64_t CJitCompiler::getCell(Context* ctx, int64_t index)
+{
+    CVanillaState& state = ctx->jit->state;
+    uint8_t* cell = (uint8_t*)ctx->tape + index*state.cellSize;
+    uint8_t c;
+
+    try {
+        //! Only the lowest byte changes, same as the interpreter
+        if (state.userInput(c)) {
+            *cell = c;
+        }
+    } catch (std::exception& e) {
+        ctx->jit->error = e.what();
+        return -1;
+    }
+    return 0;
+}
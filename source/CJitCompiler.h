@@ -0,0 +1,84 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CJIT_COMPILER_H
+#define CJIT_COMPILER_H
+
+#include "CVanillaState.h"
+
+//! Turns translated vanilla code into x86-64 machine code and runs it in-process
+//! Works on the state's own tape, so the result is the same as CVanillaState::run()
+class CJitCompiler
+{
+public:
+    //! Generates the code right away, throws if the machine can't run it
+    explicit CJitCompiler(CVanillaState& owner);
+    ~CJitCompiler();
+
+    void run();
+
+private:
+    typedef CVanillaState::BFinstr BFinstr;
+
+    //! What the generated code sees, field offsets are hardcoded into it
+    //! Indices are counted from the lowest cell, so a two-way tape needs no extra checks
+    struct Context
+    {
+        void* tape;        //! +0, the lowest cell
+        int64_t count;     //! +8
+        int64_t ptr;       //! +16
+        CJitCompiler* jit; //! +24
+        int64_t shift;     //! +32, how far indices moved when a two-way tape last grew left
+    };
+
+    CVanillaState& state;
+
+    std::vector<uint8_t> code;
+    void* buffer;
+    size_t bufferSize;
+
+    size_t failLabel;  //! Where the generated code bails out from
+    std::string error; //! Why it did
+
+    void emit8(uint8_t byte);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+    //! Points a rel32 written at 'where' to 'target'
+    void patch32(size_t where, size_t target);
+    //! Emits a jump-if-sign to the failure exit, right after a helper's 'test rax, rax'
+    void emitFailCheck();
+
+    void emitCall(const void* helper);
+    void emitReload();
+    //! Leaves the index of the cell at 'offset' in rax, reaching it first if needed
+    void emitReach(int offset);
+    void emitMove(int64_t amount);
+    //! 'op [tape + rax*cellSize], reg', picking the opcode for the cell size
+    void emitCellOp(uint8_t opByte, uint8_t opWide, int reg);
+    //! The SIB byte of [tape + rax*cellSize], every cell access goes through it
+    uint8_t cellSIB() const;
+
+    void translate();
+
+    static int64_t reachCell(Context* ctx, int64_t index);
+    //! Points the context at the state's tape, as it is now
+    static void updateContext(Context* ctx);
+    static void putCell(Context* ctx, int64_t c, int64_t count);
+    static int64_t getCell(Context* ctx, int64_t index);
+    //! Same as the interpreter's OP_COPY and OP_SKIP, the loop after it deals with EOF
+    static void feedCell(Context* ctx, int64_t index, int64_t value, int64_t echo);
+};
+
+#endif // CJIT_COMPILER_H
@@ -39,11 +39,7 @@ void CJumpState::translate(istream& input)
         case '+':
         case '-':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -64,6 +60,8 @@ void CJumpState::translate(istream& input)
     if (bracesCount != 0) {
         throw runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
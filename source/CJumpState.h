@@ -35,6 +35,9 @@ public:
 protected:
     std::map<CellType, unsigned> jumpPoints;
 
+    bool hasPlainRuntime() const {
+        return false;
+    }
     void runInstruction(const BFinstr& instr);
 };
 
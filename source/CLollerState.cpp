@@ -19,7 +19,7 @@
 
 #include <png++/png.hpp>
 
-CLollerState::CLollerState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+CLollerState::CLollerState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug)
 {}
 
@@ -79,11 +79,7 @@ void CLollerState::translate(std::istream& input)
             case '+':
             case '-':
                 //! A way to "optimize"/compress BF code, add many consecutive commands together
-                if (!instructions.empty() && instructions.back().token == c) {
-                    instructions.back().incr();
-                } else {
-                    instructions.push_back(BFinstr(c));
-                }
+                pushInstr(BFinstr(c));
             break;
             case '.':
             case ',':
@@ -126,6 +122,8 @@ void CLollerState::translate(std::istream& input)
     if (bracesCount != 0) {
         throw std::runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -21,7 +21,7 @@
 class CLollerState : public CVanillaState
 {
 public:
-    CLollerState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CLollerState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CLollerState();
 
     void translate(std::istream& input);
@@ -19,7 +19,7 @@
 
 using namespace std;
 
-CLoveState::CLoveState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+CLoveState::CLoveState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug), storage({0})
 {}
 
@@ -42,11 +42,7 @@ void CLoveState::translate(istream& input)
         case '+':
         case '-':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '~':
             if (bracesCount == 0 && parenCount == 0) {
@@ -83,6 +79,19 @@ void CLoveState::translate(istream& input)
     } else if (parenCount != 0) {
         throw runtime_error("Opening and closing parenthesis don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
+    linkJumps('(', ')');
+    //! '~' lands on the first closing brace or parenthesis that follows it
+    for (unsigned i = 0; i < instructions.size(); i++) {
+        if (instructions[i].token == '~') {
+            unsigned j = i + 1;
+            while (instructions[j].token != ')' && instructions[j].token != ']') {
+                ++j;
+            }
+            instructions[i].jump = j;
+        }
+    }
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -90,6 +99,20 @@ void CLoveState::translate(istream& input)
     }
 }
 
+bool CLoveState::keepsLoop(size_t open) const
+{
+    //! Any closing brace or parenthesis in between would catch the '~' first
+    while (open > 0) {
+        char token = instructions[--open].token;
+        if (token == '~') {
+            return true;
+        } else if (token == ']' || token == ')') {
+            return false;
+        }
+    }
+    return false;
+}
+
 void CLoveState::compilePreInst(std::ostream& output)
 {
     output << "CellType storage = 0;" << endl;
@@ -104,41 +127,16 @@ void CLoveState::runInstruction(const BFinstr& instr)
     {
     case '(':
         if (getCell(curPtrPos).c64 != 0) {
-            int depth = 1;
-            //! Make sure the parenthesis it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                ++IP;
-                char token = getCode(IP).token;
-                if (token == '(') {
-                    ++depth;
-                } else if (token == ')') {
-                    --depth;
-                }
-            }
+            IP = instr.jump;
         }
     break;
     case ')':
         if (getCell(curPtrPos).c64 == 0) {
-            int depth = 1;
-            //! Make sure the parenthesis it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                --IP;
-                char token = getCode(IP).token;
-                if (token == '(') {
-                    --depth;
-                } else if (token == ')') {
-                    ++depth;
-                }
-            }
+            IP = instr.jump;
         }
     break;
     case '~':
-        for (;;) {
-            char token = getCode(++IP).token;
-            if (token == ')' || token == ']') {
-                break;
-            }
-        }
+        IP = instr.jump;
     break;
     case '$':
         storage = getCell(curPtrPos);
@@ -185,11 +183,7 @@ void CLoveState::runDebug()
             cout << "Current IP      : " << IP << endl;
             cout << "Current Pointer : " << curPtrPos << endl;
             cout << "Current Storage : " << storage.c64 << endl;
-            cout << "Next instruction: " << tempCode.token;
-            if (tempCode.repeat > 1) {
-                cout << " x" << tempCode.repeat;
-            }
-            cout << endl;
+            cout << "Next instruction: " << describe(tempCode) << endl;
 
             char choice;
             cout << "What to do ( h ): ";
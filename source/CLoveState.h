@@ -21,7 +21,7 @@
 class CLoveState : public CVanillaState
 {
 public:
-    CLoveState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CLoveState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CLoveState();
 
     //! Converts BF code to manageable token blocks, compressed/optimized if possible
@@ -31,6 +31,11 @@ private:
     CellType storage; //! Extra storage cell required by Brainlove
 
     void compilePreInst(std::ostream& output);
+    bool hasPlainRuntime() const {
+        return false;
+    }
+    //! '~' lands on the closing brace of a loop that directly follows it, so that one can't go away
+    bool keepsLoop(size_t open) const;
     void runInstruction(const BFinstr& instr);
     void compileInstruction(std::ostream& output, const BFinstr& instr);
 
@@ -0,0 +1,57 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "CMemoryBudget.h"
+
+#include <stdexcept>
+#include <sstream>
+
+void CMemoryBudget::charge(const std::string& name, uint64_t bytes)
+{
+    Usage& entry = usage[name];
+    uint64_t newTotal = total - entry.current + bytes;
+
+    if (limit != 0 && newTotal > limit) {
+        std::ostringstream message;
+        message << "Memory limit of " << limit << " bytes exceeded, the " << name << " needed " << bytes << " bytes";
+        if (newTotal != bytes) {
+            message << " with " << newTotal - bytes << " already in use";
+        }
+        message << '.';
+        throw std::runtime_error(message.str());
+    }
+
+    entry.current = bytes;
+    if (bytes > entry.peak) {
+        entry.peak = bytes;
+    }
+    total = newTotal;
+    if (total > peak) {
+        peak = total;
+    }
+}
+
+void CMemoryBudget::report(std::ostream& output) const
+{
+    for (auto& entry : usage) {
+        output << "Peak " << entry.first << ": " << entry.second.peak << " bytes" << std::endl;
+    }
+    output << "Peak total: " << peak << " bytes";
+    if (limit != 0) {
+        output << " of " << limit << " allowed";
+    }
+    output << std::endl;
+}
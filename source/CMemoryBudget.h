@@ -0,0 +1,66 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CMEMORY_BUDGET_H
+#define CMEMORY_BUDGET_H
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+//! Keeps count of the bytes every growing structure( tape, stacks ) takes, all of them against one limit
+//! Also remembers the most each one ever took, for right-sizing the next run
+class CMemoryBudget
+{
+public:
+    //! Shared by every state, the limit has to be set before constructing one
+    static CMemoryBudget& instance() {
+        static CMemoryBudget budget;
+        return budget;
+    }
+
+    //! In bytes, 0 means there's none
+    void setLimit(uint64_t bytes) {
+        limit = bytes;
+    }
+    uint64_t getLimit() const {
+        return limit;
+    }
+
+    //! Tells the budget that 'name' is about to take 'bytes' in total, before it actually does
+    //! Throws if that puts everything together over the limit, nothing changes then
+    void charge(const std::string& name, uint64_t bytes);
+
+    //! Prints the high-water mark of each structure and of all of them together
+    void report(std::ostream& output) const;
+
+private:
+    CMemoryBudget(): limit(0), total(0), peak(0) {}
+
+    struct Usage
+    {
+        uint64_t current;
+        uint64_t peak;
+    };
+    std::map<std::string, Usage> usage;
+
+    uint64_t limit;
+    uint64_t total; //! Everything together, right now
+    uint64_t peak;  //! The most 'total' ever was
+};
+
+#endif // CMEMORY_BUDGET_H
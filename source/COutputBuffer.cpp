@@ -0,0 +1,83 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "COutputBuffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <unistd.h>
+
+void COutputBuffer::fill(char c, int64_t count)
+{
+    while (count > 0) {
+        if (used == bufferSize) {
+            flush();
+        }
+        size_t chunk = std::min<uint64_t>(count, bufferSize - used);
+        memset(data + used, c, chunk);
+        used += chunk;
+        count -= chunk;
+    }
+}
+
+void COutputBuffer::write(const char* bytes, size_t count)
+{
+    //! Big enough to go out on its own, without copying it first
+    if (count >= bufferSize) {
+        flush();
+        writeAll(bytes, count);
+        return;
+    }
+    while (count > 0) {
+        if (used == bufferSize) {
+            flush();
+        }
+        size_t chunk = std::min(count, bufferSize - used);
+        memcpy(data + used, bytes, chunk);
+        used += chunk;
+        bytes += chunk;
+        count -= chunk;
+    }
+}
+
+void COutputBuffer::flush()
+{
+    std::cout.flush();
+    fflush(stdout);
+
+    writeAll(data, used);
+    used = 0;
+}
+
+void COutputBuffer::writeAll(const char* bytes, size_t count)
+{
+    size_t done = 0;
+    while (done < count) {
+        ssize_t written = ::write(STDOUT_FILENO, bytes + done, count - done);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        done += written;
+    }
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef COUTPUT_BUFFER_H
+#define COUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! Collects whatever programs print and hands it to write(2) in big chunks, instead of going through iostreams per character
+//! Flushed when full, before reading input and at exit, anything else printing to stdout has to flush it first
+class COutputBuffer
+{
+public:
+    //! Shared by every state, there's only one stdout
+    static COutputBuffer& instance() {
+        static COutputBuffer buffer;
+        return buffer;
+    }
+
+    void put(char c) {
+        if (used == bufferSize) {
+            flush();
+        }
+        data[used++] = c;
+    }
+    //! Writes 'c' 'count' times, which is what consecutive '.' on the same cell come down to
+    void fill(char c, int64_t count);
+    void write(const char* bytes, size_t count);
+
+    //! Whatever went through std::cout or stdio goes out first, to keep everything in order
+    //! Write errors are dropped, same as std::cout.put() did
+    void flush();
+
+private:
+    COutputBuffer(): used(0) {}
+    ~COutputBuffer() {
+        flush();
+    }
+
+    //! Straight to stdout, no matter what's in the buffer
+    static void writeAll(const char* bytes, size_t count);
+
+    static const size_t bufferSize = (size_t)1 << 16;
+    char data[bufferSize];
+    size_t used;
+};
+
+#endif // COUTPUT_BUFFER_H
@@ -17,7 +17,7 @@
 
 using namespace std;
 
-CSelfmodState::CSelfmodState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+CSelfmodState::CSelfmodState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug)
 {}
 
@@ -76,8 +76,7 @@ void CSelfmodState::runInstruction(const BFinstr& instr)
 CVanillaState::BFinstr& CSelfmodState::getCode(int ip)
 {
     static BFinstr localBuffer(0);
-    localBuffer.token = getCell(ip).c8;
-    localBuffer.repeat = 1;
+    localBuffer = BFinstr(getCell(ip).c8);
 
     return localBuffer;
 }
@@ -21,7 +21,7 @@
 class CSelfmodState : public CVanillaState
 {
 public:
-    CSelfmodState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CSelfmodState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CSelfmodState();
 
     //! Prepares code to be run
@@ -31,6 +31,9 @@ public:
     void compile(std::ostream& output);
 
 protected:
+    bool hasPlainRuntime() const {
+        return false;
+    }
     void runInstruction(const BFinstr& instr);
     BFinstr& getCode(int ip);
 
@@ -0,0 +1,43 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CSparseTape.h"
+#include "CMemoryBudget.h"
+
+#include <limits>
+
+CSparseTape::CSparseTape(int size)
+: cellSize(size), lastPage(std::numeric_limits<int64_t>::min()), lastData(nullptr), zeroCell(0)
+{}
+
+uint8_t* CSparseTape::findPage(int64_t index, bool create)
+{
+    //! Shifting rounds down, so negative indices get pages of their own too
+    int64_t number = index >> pageShift;
+
+    auto found = pages.find(number);
+    if (found == pages.end()) {
+        if (!create) {
+            return (uint8_t*)&zeroCell;
+        }
+        CMemoryBudget::instance().charge("tape", (pages.size() + 1)*(cellSize << pageShift));
+        std::unique_ptr<uint8_t[]> page(new uint8_t[cellSize << pageShift]());
+        found = pages.emplace(number, std::move(page)).first;
+    }
+
+    lastPage = number;
+    lastData = found->second.get();
+    return lastData + (index & pageMask)*cellSize;
+}
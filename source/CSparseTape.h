@@ -0,0 +1,65 @@
+// Copyright (C) 2017-2019, GReaperEx(Marios F.)
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 only.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSPARSE_TAPE_H
+#define CSPARSE_TAPE_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+//! Tape made of fixed-size pages that only exist once something is written to them
+//! Cells can be billions of positions apart, memory only goes to the pages actually used
+class CSparseTape
+{
+public:
+    explicit CSparseTape(int size);
+
+    //! Where the cell's bytes are, a shared zero cell if its page was never written to
+    const uint8_t* peek(int64_t index) {
+        if ((index >> pageShift) == lastPage) {
+            return lastData + (index & pageMask)*cellSize;
+        }
+        return findPage(index, false);
+    }
+    //! Same, but creates the page if it's missing
+    uint8_t* poke(int64_t index) {
+        if ((index >> pageShift) == lastPage) {
+            return lastData + (index & pageMask)*cellSize;
+        }
+        return findPage(index, true);
+    }
+
+    size_t pageCount() const {
+        return pages.size();
+    }
+
+    static const int pageShift = 12; //! 4096 cells per page
+    static const int64_t pageMask = ((int64_t)1 << pageShift) - 1;
+
+private:
+    int cellSize;
+    std::unordered_map<int64_t, std::unique_ptr<uint8_t[]>> pages;
+
+    //! Last page found, sequential access hardly ever goes through the map
+    int64_t lastPage;
+    uint8_t* lastData;
+
+    uint64_t zeroCell; //! What peek() points to for missing pages
+
+    uint8_t* findPage(int64_t index, bool create);
+};
+
+#endif // CSPARSE_TAPE_H
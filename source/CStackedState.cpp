@@ -19,7 +19,7 @@
 
 using namespace std;
 
-CStackedState::CStackedState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+CStackedState::CStackedState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
 : CVanillaState(size, count, wrapPtr, dynamicTape, onEOF, dataFile, debug)
 {}
 
@@ -41,11 +41,7 @@ void CStackedState::translate(istream& input)
         case '+':
         case '-':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -75,12 +71,14 @@ void CStackedState::translate(istream& input)
     if (bracesCount != 0) {
         throw runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
     //! Save any remaining data on the stack
     if (c == '!') {
         while (input.get(c)) {
             CellType temp { 0 };
             temp.c8 = c;
-            cellStack.push_back(temp);
+            pushStack(cellStack, temp);
         }
     }
     //! It should ignore the last newline
@@ -96,6 +94,9 @@ void CStackedState::compilePreMain(std::ostream& output)
     output << "void* pushStack(CellType* p, int* size, int* index, CellType newVal) {" << endl;
     output << "++*index;" << endl;
     output << "if (*index == *size) {" << endl;
+    if (budgeted()) {
+        output << "chargeMemory(&stackAccount, \"stack\", (*size + 1)*sizeof(CellType));" << endl;
+    }
     output << "p = realloc(p, (++*size)*sizeof(CellType));" << endl;
     output << "if (!p) {" << endl;
     output << "fputs(\"Out of memory!\\n\", stderr);" << endl;
@@ -173,7 +174,7 @@ void CStackedState::runInstruction(const BFinstr& instr)
         }
     break;
     case ')':
-        cellStack.push_back(getCell(curPtrPos));
+        pushStack(cellStack, getCell(curPtrPos));
     break;
     case '@':
         if (!cellStack.empty()) {
@@ -313,11 +314,7 @@ void CStackedState::runDebug()
             cout << "Current IP      : " << IP << endl;
             cout << "Current Pointer :" << curPtrPos << endl;
             cout << "Stack size      : " << cellStack.size() << endl;
-            cout << "Next instruction: " << tempCode.token;
-            if (tempCode.repeat > 1) {
-                cout << " x" << tempCode.repeat;
-            }
-            cout << endl;
+            cout << "Next instruction: " << describe(tempCode) << endl;
 
             char choice;
             cout << "What to do ( h ): ";
@@ -402,7 +399,7 @@ void CStackedState::runDebug()
                     cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                 }
 
-                cellStack.push_back(newVal);
+                pushStack(cellStack, newVal);
             }
             break;
             case 'p':
@@ -21,7 +21,7 @@
 class CStackedState : public CVanillaState
 {
 public:
-    CStackedState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CStackedState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CStackedState();
 
     //! Converts BF code to manageable token blocks, compressed/optimized if possible
@@ -34,6 +34,9 @@ protected:
     void compilePreInst(std::ostream& output);
     void compileCleanup(std::ostream& output);
 
+    bool hasPlainRuntime() const {
+        return false;
+    }
     void runInstruction(const BFinstr& instr);
     void compileInstruction(std::ostream& output, const BFinstr& instr);
 
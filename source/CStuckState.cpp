@@ -19,7 +19,7 @@
 
 using namespace std;
 
-CStuckState::CStuckState(int size, int count, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+CStuckState::CStuckState(int size, int64_t count, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
 : CVanillaState(size, count, false, dynamicTape, onEOF, dataFile, debug)
 {}
 
@@ -39,11 +39,7 @@ void CStuckState::translate(istream& input)
         case '+':
         case '-':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -64,6 +60,7 @@ void CStuckState::translate(istream& input)
     if (bracesCount != 0) {
         throw runtime_error("Opening and closing braces don't match.");
     }
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -92,29 +89,22 @@ void CStuckState::compilePreMain(std::ostream& output)
 
 void CStuckState::runInstruction(const BFinstr& instr)
 {
-    switch (instr.token)
-    {
-    case '+':
+    switch (instr.op)
     {
-        CellType temp = getCell(curPtrPos);
-        temp.c64 += instr.repeat;
-        setCell(curPtrPos, temp);
-    }
-    break;
-    case '-':
+    case OP_ADD:
     {
         CellType temp = getCell(curPtrPos);
-        temp.c64 -= instr.repeat;
+        temp.c64 += instr.value;
         setCell(curPtrPos, temp);
     }
     break;
-    case '.':
+    case OP_OUT:
     {
         CellType temp = getCell(curPtrPos--);
-        cout.put(temp.c8);
+        COutputBuffer::instance().put(temp.c8);
     }
     break;
-    case ',':
+    case OP_IN:
     {
         CellType temp = { 0 };
 
@@ -123,94 +113,74 @@ void CStuckState::runInstruction(const BFinstr& instr)
         }
     }
     break;
-    case '0':
-    {
-        CellType temp { 0 };
-        setCell(++curPtrPos, temp);
-    }
-    break;
-    case ':':
-    {
-        CellType temp = getCell(curPtrPos--);
-        temp = getCell(curPtrPos - temp.c32);
-        setCell(++curPtrPos, temp);
-    }
+    case OP_EXT:
+        if (instr.token == '0') {
+            CellType temp { 0 };
+            setCell(++curPtrPos, temp);
+        } else { //! ':'
+            CellType temp = getCell(curPtrPos--);
+            temp = getCell(curPtrPos - temp.c32);
+            setCell(++curPtrPos, temp);
+        }
     break;
-    case '[':
+    case OP_OPEN:
         if (getCell(curPtrPos--).c64 == 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                ++IP;
-                char token = getCode(IP).token;
-                if (token == '[') {
-                    ++depth;
-                } else if (token == ']') {
-                    --depth;
-                }
-            }
+            IP = instr.jump;
         }
     break;
-    case ']':
-    {
-        int depth = 1;
-        //! Make sure the brace it jumps to is the correct one, at the same level
-        while (depth > 0) {
-            --IP;
-            char token = getCode(IP).token;
-            if (token == '[') {
-                --depth;
-            } else if (token == ']') {
-                ++depth;
-            }
-        }
-        --IP;
-    }
+    case OP_CLOSE:
+        //! Lands right before the '[' so it gets to pop the stack again
+        IP = instr.jump - 1;
+    break;
+    default:
     break;
     }
 }
 
 void CStuckState::compileInstruction(std::ostream& output, const BFinstr& instr)
 {
-    int repeat = instr.repeat;
-    switch (instr.token)
+    switch (instr.op)
     {
-    case '+':
-        output << "p[index] += " << repeat << ';' << endl;
-    break;
-    case '-':
-        output << "p[index] -= " << repeat << ';' << endl;
+    case OP_ADD:
+        if (instr.value > 0) {
+            output << "p[index] += " << instr.value << ';' << endl;
+        } else {
+            output << "p[index] -= " << -instr.value << ';' << endl;
+        }
     break;
-    case '.':
-        output << "putchar(popStack(p, &size, &index));" << endl;
+    case OP_OUT:
+        output << "putOutput(popStack(p, &size, &index));" << endl;
     break;
-    case ',':
+    case OP_IN:
         if (eofPolicy == NOP) {
             output << "{" << endl;
             output << "CellType tempC = 1;" << endl;
             output << "getInput(&tempC);" << endl;
             output << "if (tempC != 1) {" << endl;
         }
-        output << "pushStack(&p, &size, &index, getchar());" << endl;
+        output << "pushStack(&p, &size, &index, getByte());" << endl;
         if (eofPolicy == NOP) {
             output << "}" << endl;
             output << "}" << endl;
         }
     break;
-    case '[':
+    case OP_OPEN:
         output << "while (popStack(p, &size, &index)) {" << endl;
     break;
-    case ']':
+    case OP_CLOSE:
         output << "}" << endl;
     break;
-    case '0':
-        output << "pushStack(&p, &size, &index, 0);" << endl;
+    case OP_EXT:
+        if (instr.token == '0') {
+            output << "pushStack(&p, &size, &index, 0);" << endl;
+        } else { //! ':'
+            output << "{" << endl;
+            output << "CellType temp = popStack(p, &size, &index)];" << endl;
+            output << "pushStack(&p, &size, &index, p[(uint32_t)(index - temp)]);" << endl;
+            output << "}" << endl;
+        }
     break;
-    case ':':
-        output << "{" << endl;
-        output << "CellType temp = popStack(p, &size, &index)];" << endl;
-        output << "pushStack(&p, &size, &index, p[(uint32_t)(index - temp)]);" << endl;
-        output << "}" << endl;
+    default:
     break;
     }
 }
@@ -228,11 +198,7 @@ void CStuckState::runDebug()
             cout << "-----------------" << endl;
             cout << "Current IP      : " << IP << endl;
             cout << "Stack size      : " << curPtrPos << endl;
-            cout << "Next instruction: " << tempCode.token;
-            if (tempCode.repeat > 1) {
-                cout << " x" << tempCode.repeat;
-            }
-            cout << endl;
+            cout << "Next instruction: " << describe(tempCode) << endl;
 
             char choice;
             cout << "What to do ( h ): ";
@@ -21,7 +21,7 @@
 class CStuckState : public CVanillaState
 {
 public:
-    CStuckState(int size, int count, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CStuckState(int size, int64_t count, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CStuckState();
 
     //! Converts BF code to manageable token blocks, compressed/optimized if possible
@@ -30,6 +30,9 @@ public:
 protected:
     void compilePreMain(std::ostream& output);
 
+    bool hasPlainRuntime() const {
+        return false;
+    }
     void runInstruction(const BFinstr& instr);
     void compileInstruction(std::ostream& output, const BFinstr& instr);
 
@@ -14,15 +14,21 @@
  */
 
 #include "CVanillaState.h"
+#include "CJitCompiler.h"
+#include "CBackgroundCompiler.h"
 
 #include <limits>
+#include <map>
 
 #include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 CVanillaState* CVanillaState::state = nullptr;
+CVanillaState* CVanillaState::guardOwner = nullptr;
 
-CVanillaState::CVanillaState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
-: curPtrPos(0), IP(0), doDebug(debug), dbgPaused(true)
+CVanillaState::CVanillaState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug)
+: cellLow(0), sparseTape(size), curPtrPos(0), IP(0), nativeReady(false), footprintKnown(false), staticTape(false), unchecked(false), guardHigh(false), guardLow(false), hostedTape(false), doDebug(debug), dbgPaused(true)
 {
     if (size != 1 && size != 2 && size != 4 && size != 8) {
         throw std::runtime_error("Invalid cell size. Only 1, 2, 4 and 8 are supported.");
@@ -46,12 +52,19 @@ CVanillaState::CVanillaState(int size, int count, bool wrapPtr, bool dynamicTape
 
     ptrWrap = wrapPtr;
     dynamic = dynamicTape;
+    twoWay = dynamicTape && tapeLayout().twoWay;
+    sparse = tapeLayout().sparse;
     eofPolicy = onEOF;
 
-    tape = calloc(cellCount, cellSize);
-    if (tape == nullptr) {
-        throw std::runtime_error("There's not enough memory available!");
-    }
+    ring = false;
+    guarded = false;
+    hugePages = tapeLayout().hugePages;
+    hugeMethod = HUGE_NONE;
+
+    allocTape(cellCount);
+
+    //! Only known once the tape is there, whether it could be mapped as a ring or between guards
+    core = pickCore(size, wrapPtr, dynamicTape, twoWay, sparse, ring, guarded, onEOF);
 
     if (!dataFile.empty()) {
         std::ifstream input(dataFile);
@@ -63,6 +76,7 @@ CVanillaState::CVanillaState(int size, int count, bool wrapPtr, bool dynamicTape
     }
 
     if (doDebug) {
+        CInputBuffer::instance().useStreams();
         CVanillaState::state = this;
         signal(SIGINT, CVanillaState::signalHandle);
     }
@@ -70,7 +84,7 @@ CVanillaState::CVanillaState(int size, int count, bool wrapPtr, bool dynamicTape
 
 CVanillaState::~CVanillaState()
 {
-    free(tape);
+    freeTape();
 }
 
 void CVanillaState::translate(std::istream& input)
@@ -88,11 +102,7 @@ void CVanillaState::translate(std::istream& input)
         case '+':
         case '-':
             //! A way to "optimize"/compress BF code, add many consecutive commands together
-            if (!instructions.empty() && instructions.back().token == c) {
-                instructions.back().incr();
-            } else {
-                instructions.push_back(BFinstr(c));
-            }
+            pushInstr(BFinstr(c));
         break;
         case '.':
         case ',':
@@ -111,6 +121,8 @@ void CVanillaState::translate(std::istream& input)
     if (bracesCount != 0) {
         throw std::runtime_error("Opening and closing braces don't match.");
     }
+    optimize();
+    linkJumps('[', ']');
 
     //! Appends collected data to tape
     for (unsigned i = 0; i < initData.size(); i++) {
@@ -123,8 +135,45 @@ void CVanillaState::run()
     IP = 0;
     keepRunning = hasInstructions();
 
+    //! The debugger needs to see every step, so it keeps going through runInstruction()
+    if (keepRunning && !doDebug && hasPlainRuntime()) {
+        analyzeLoops();
+        measureFootprint();
+        if (sparse) {
+            //! Native code only knows contiguous tapes
+            if (tuning().jit) {
+                std::cerr << "Warning: JIT compiling isn't available here, interpreting instead." << std::endl;
+            }
+            (this->*core)();
+        } else if (tuning().jit) {
+            CJitCompiler(*this).run();
+            keepRunning = false;
+        } else if (tuning().compileRun) {
+            CBackgroundCompiler native(*this);
+            if (!native.wait()) {
+                throw std::runtime_error("Wasn't able to compile requested code.");
+            }
+            native.resume();
+            keepRunning = false;
+        } else if (tuning().background) {
+            CBackgroundCompiler native(*this);
+            //! Stops early, with keepRunning still set, once the native code is ready
+            (this->*core)();
+            if (keepRunning) {
+                native.resume();
+                keepRunning = false;
+            }
+        } else {
+            (this->*core)();
+        }
+        return;
+    } else if (tuning().jit) {
+        std::cerr << "Warning: JIT compiling isn't available here, interpreting instead." << std::endl;
+    }
+
     while (keepRunning) {
         if (doDebug) {
+            COutputBuffer::instance().flush();
             runDebug();
         }
 
@@ -133,62 +182,622 @@ void CVanillaState::run()
     }
 }
 
+//! Cells are right there in 'tape', the policy only decides which index to use
+template <typename Policy>
+struct CVanillaState::ContiguousTape
+{
+    static const bool contiguous = true;
+    static const bool guarded = false;
+
+    template <typename Cell>
+    static Cell& at(CVanillaState& state, int64_t index) {
+        return ((Cell*)state.tape)[Policy::reach(state, index)];
+    }
+    template <typename Cell>
+    static Cell get(CVanillaState& state, int64_t index) {
+        return ((Cell*)state.tape)[Policy::reach(state, index)];
+    }
+    //! For cells already known to be on the tape, see coversLoop()
+    template <typename Cell>
+    static Cell& rawAt(CVanillaState& state, int64_t index) {
+        return ((Cell*)state.tape)[index];
+    }
+    template <typename Cell>
+    static Cell rawGet(CVanillaState& state, int64_t index) {
+        return ((Cell*)state.tape)[index];
+    }
+};
+
+struct CVanillaState::BoundedTape : ContiguousTape<BoundedTape>
+{
+    static const bool wraps = false;
+
+    static int64_t reach(CVanillaState& state, int64_t index) {
+        if (index < 0) {
+            throw std::runtime_error("Pointer was decremented too much.");
+        } else if (index >= state.cellCount) {
+            throw std::runtime_error("Pointer was incremented too much.");
+        }
+        return index;
+    }
+    static int64_t move(CVanillaState&, int64_t index) {
+        return index;
+    }
+};
+
+struct CVanillaState::GuardedTape : ContiguousTape<GuardedTape>
+{
+    static const bool wraps = false;
+    static const bool guarded = true;
+
+    //! Past the end is up to the guards, see guardFault()
+    static int64_t reach(CVanillaState& state, int64_t index) {
+        if (index < state.guardFloor) {
+            throw std::runtime_error("Pointer was decremented too much.");
+        }
+        return index;
+    }
+    //! Moves are checked instead, so that no offset from the pointer can jump over a guard
+    static int64_t move(CVanillaState& state, int64_t index) {
+        if ((uint64_t)(index + state.guardCells) >= (uint64_t)(state.cellCount + 2*state.guardCells)) {
+            if (index < 0) {
+                throw std::runtime_error("Pointer was decremented too much.");
+            }
+            throw std::runtime_error("Pointer was incremented too much.");
+        }
+        return index;
+    }
+};
+
+struct CVanillaState::WrappedTape : ContiguousTape<WrappedTape>
+{
+    static const bool wraps = true;
+
+    static int64_t reach(CVanillaState& state, int64_t index) {
+        return move(state, index);
+    }
+    //! Keeps the pointer itself in range, so 'index' never drifts away
+    static int64_t move(CVanillaState& state, int64_t index) {
+        if ((uint64_t)index >= (uint64_t)state.cellCount) {
+            index = (index % state.cellCount + state.cellCount) % state.cellCount;
+        }
+        return index;
+    }
+};
+
+struct CVanillaState::RingTape : ContiguousTape<RingTape>
+{
+    static const bool wraps = true;
+
+    //! The mirrors on either side take care of anything within one tape length
+    static int64_t reach(CVanillaState& state, int64_t index) {
+        return move(state, index);
+    }
+    //! So the pointer only has to be brought back once it strays further than that
+    static int64_t move(CVanillaState& state, int64_t index) {
+        if ((uint64_t)(index + state.cellCount) >= (uint64_t)(3*state.cellCount)) {
+            state.examineIndex(index);
+        }
+        return index;
+    }
+};
+
+struct CVanillaState::DynamicTape : ContiguousTape<DynamicTape>
+{
+    static const bool wraps = false;
+
+    static int64_t reach(CVanillaState& state, int64_t index) {
+        if ((uint64_t)index >= (uint64_t)state.cellCount) {
+            state.examineIndex(index);
+        }
+        return index;
+    }
+    static int64_t move(CVanillaState&, int64_t index) {
+        return index;
+    }
+};
+
+struct CVanillaState::TwoWayTape : ContiguousTape<TwoWayTape>
+{
+    static const bool wraps = false;
+
+    //! Still a single comparison, everything is measured from the lowest cell
+    static int64_t reach(CVanillaState& state, int64_t index) {
+        if ((uint64_t)(index - state.cellLow) >= (uint64_t)(state.cellCount - state.cellLow)) {
+            state.examineIndex(index);
+        }
+        return index;
+    }
+    static int64_t move(CVanillaState&, int64_t index) {
+        return index;
+    }
+};
+
+struct CVanillaState::SparseTape
+{
+    static const bool wraps = false;
+    static const bool contiguous = false;
+    static const bool guarded = false;
+
+    //! Bounds, wrapping and growth work like they do on any other tape, only the cells live elsewhere
+    static int64_t reach(CVanillaState& state, int64_t index) {
+        if ((uint64_t)(index - state.cellLow) >= (uint64_t)(state.cellCount - state.cellLow)) {
+            state.examineIndex(index);
+        }
+        return index;
+    }
+    static int64_t move(CVanillaState& state, int64_t index) {
+        return state.ptrWrap ? reach(state, index) : index;
+    }
+
+    //! Writing is what creates pages, reading a missing one just gives zero
+    template <typename Cell>
+    static Cell& at(CVanillaState& state, int64_t index) {
+        return *(Cell*)state.sparseTape.poke(reach(state, index));
+    }
+    template <typename Cell>
+    static Cell get(CVanillaState& state, int64_t index) {
+        return *(const Cell*)state.sparseTape.peek(reach(state, index));
+    }
+    template <typename Cell>
+    static Cell& rawAt(CVanillaState& state, int64_t index) {
+        return *(Cell*)state.sparseTape.poke(index);
+    }
+    template <typename Cell>
+    static Cell rawGet(CVanillaState& state, int64_t index) {
+        return *(const Cell*)state.sparseTape.peek(index);
+    }
+};
+
+//! GCC's labels-as-values let every handler jump straight to the next one
+//! Anything else gets a plain switch in a loop, which does the same thing a bit slower
+#ifdef __GNUC__
+#define CORE_CASE(name) do_##name
+#define CORE_NEXT() goto *(++next)->handler
+#define CORE_JUMP(target) next = code + (target); goto *next->handler
+#else
+#define CORE_CASE(name) case OP_##name
+#define CORE_NEXT() ++next; continue
+#define CORE_JUMP(target) next = code + (target); continue
+#endif
+
+//! Decoded once per run, so the loop never goes through getCode() or runInstruction()
+struct CVanillaState::Threaded {
+    const void* handler;
+    const void* fast; //! Handler without any checks, used inside balanced loops
+    OpCode op;
+    int offset;
+    int source;
+    int64_t value;
+    int jump;
+};
+
+template <typename Cell, typename Tape, IBasicState::ActionOnEOF onEOF>
+void CVanillaState::runCore()
+{
+    std::vector<Threaded> decoded;
+
+    //! Keeps guardFault() in charge of SIGSEGV for as long as the core runs, whichever way it leaves
+    struct GuardScope {
+        bool armed;
+        struct sigaction previous;
+
+        GuardScope(CVanillaState* owner, bool arm): armed(arm) {
+            if (armed) {
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_sigaction = &CVanillaState::guardFault;
+                action.sa_flags = SA_SIGINFO;
+                sigemptyset(&action.sa_mask);
+                guardOwner = owner;
+                sigaction(SIGSEGV, &action, &previous);
+            }
+        }
+        ~GuardScope() {
+            if (armed) {
+                sigaction(SIGSEGV, &previous, nullptr);
+                guardOwner = nullptr;
+            }
+        }
+    } guardScope(this, Tape::guarded);
+
+    //! A fault lands back here, only runThreaded()'s frame is skipped and it has nothing to clean up
+    if (Tape::guarded) {
+        int side = sigsetjmp(guardJump, 1);
+        if (side > 0) {
+            throw std::runtime_error("Pointer was incremented too much.");
+        } else if (side < 0) {
+            throw std::runtime_error("Pointer was decremented too much.");
+        }
+    }
+
+    runThreaded<Cell, Tape, onEOF>(decoded);
+}
+
+template <typename Cell, typename Tape, IBasicState::ActionOnEOF onEOF>
+void CVanillaState::runThreaded(std::vector<Threaded>& decoded)
+{
+#ifdef __GNUC__
+    static const void* const handlers[] = {
+        &&do_NOP, &&do_ADD, &&do_MOVE, &&do_SET, &&do_OPEN, &&do_CLOSE,
+        &&do_IN, &&do_OUT, &&do_SCAN, &&do_MULADD, &&do_COPY, &&do_SKIP, &&do_EXT, &&do_END
+    };
+    //! Balanced loops never scan, end or run variant specific code, those can't come up
+    //! Input is left to the usual handlers
+    static const void* const fastHandlers[] = {
+        &&fast_NOP, &&fast_ADD, &&fast_MOVE, &&fast_SET, &&fast_OPEN, &&fast_CLOSE,
+        &&do_IN, &&fast_OUT, &&do_SCAN, &&fast_MULADD, &&do_COPY, &&do_SKIP, &&do_EXT, &&do_END
+    };
+#else
+    static const void* const handlers[OP_END + 1] = { nullptr };
+    static const void* const fastHandlers[OP_END + 1] = { nullptr };
+#endif
+
+    decoded.reserve(instructions.size() + 1);
+    for (const BFinstr& instr : instructions) {
+        //! Braces land on their partner, the handler then moves on past it
+        decoded.push_back(Threaded{ handlers[instr.op], fastHandlers[instr.op], instr.op, instr.offset, instr.source, instr.value, instr.jump });
+    }
+    decoded.push_back(Threaded{ handlers[OP_END], fastHandlers[OP_END], OP_END, 0, 0, 0, -1 });
+
+    const Threaded* code = decoded.data();
+    const Threaded* next = code;
+    int64_t ptr = curPtrPos;
+#ifdef __GNUC__
+    const Threaded* fastExit = nullptr; //! The close of the outermost loop running unchecked
+#endif
+
+#ifdef __GNUC__
+    goto *next->handler;
+#else
+    for (;;) {
+        switch (next->op)
+        {
+#endif
+    CORE_CASE(ADD):
+        Tape::template at<Cell>(*this, ptr + next->offset) += (Cell)next->value;
+        CORE_NEXT();
+    CORE_CASE(MOVE):
+        ptr = Tape::move(*this, ptr + next->value);
+        CORE_NEXT();
+    CORE_CASE(SET):
+        Tape::template at<Cell>(*this, ptr + next->offset) = (Cell)next->value;
+        CORE_NEXT();
+    CORE_CASE(OUT):
+        COutputBuffer::instance().fill((char)Tape::template get<Cell>(*this, ptr + next->offset), next->value);
+        CORE_NEXT();
+    CORE_CASE(IN):
+    {
+        Cell& cell = Tape::template at<Cell>(*this, ptr + next->offset);
+        uint8_t c;
+        //! Like userInput(), only the lowest byte of the cell changes
+        if (CInputBuffer::instance().get(c)) {
+            cell = (cell & ~(Cell)0xFF) | c;
+        } else if (onEOF == RETM1) {
+            cell |= 0xFF;
+        } else if (onEOF == RET0) {
+            cell &= ~(Cell)0xFF;
+        } else if (onEOF == ABORT) {
+            throw std::runtime_error("Encountered EOF while processing input.");
+        }
+        CORE_NEXT();
+    }
+    CORE_CASE(SCAN):
+        if (sizeof(Cell) == 1 && Tape::contiguous && !Tape::wraps && (next->value == 1 || next->value == -1)) {
+            //! reach() takes care of bounds and growth, the rest is up to memchr
+            while (Tape::template get<Cell>(*this, ptr) != 0) {
+                uint8_t* cells = (uint8_t*)tape;
+                void* found;
+                if (next->value == 1) {
+                    found = memchr(cells + ptr, 0, cellCount - ptr);
+                    ptr = found ? (uint8_t*)found - cells : cellCount;
+                } else {
+                    found = memrchr(cells + cellLow, 0, ptr - cellLow + 1);
+                    ptr = found ? (uint8_t*)found - cells : cellLow - 1;
+                }
+            }
+        } else {
+            while (Tape::template get<Cell>(*this, ptr) != 0) {
+                ptr = Tape::move(*this, ptr + next->value);
+            }
+        }
+        CORE_NEXT();
+    CORE_CASE(MULADD):
+    {
+        Cell source = Tape::template get<Cell>(*this, ptr + next->source);
+        if (source != 0) {
+            Tape::template at<Cell>(*this, ptr + next->offset) += source * (Cell)next->value;
+        }
+        CORE_NEXT();
+    }
+    CORE_CASE(COPY):
+    CORE_CASE(SKIP):
+    {
+        Cell& cell = Tape::template at<Cell>(*this, ptr);
+        cell = feedLoop(cell, next->value, next->op == OP_COPY);
+        CORE_NEXT();
+    }
+    CORE_CASE(OPEN):
+        if (Tape::template get<Cell>(*this, ptr) == 0) {
+            CORE_JUMP(next->jump + 1);
+        }
+#ifdef __GNUC__
+        //! Once the tape is known to cover a balanced loop, it runs without any checks
+        if (loopSpans[next - code].balanced && coversLoop<Tape>(ptr, loopSpans[next - code])) {
+            fastExit = code + next->jump;
+            goto *(++next)->fast;
+        }
+#endif
+        CORE_NEXT();
+    CORE_CASE(CLOSE):
+        if (Tape::template get<Cell>(*this, ptr) != 0) {
+            if (nativeReady.load(std::memory_order_relaxed)) {
+                //! Native code takes over from the matching '['
+                IP = next->jump;
+                curPtrPos = Tape::wraps ? WrappedTape::move(*this, ptr) : ptr;
+                return;
+            }
+            CORE_JUMP(next->jump + 1);
+        }
+        CORE_NEXT();
+    CORE_CASE(NOP):
+    CORE_CASE(EXT):
+        CORE_NEXT();
+    CORE_CASE(END):
+#ifndef __GNUC__
+        break;
+        }
+        break;
+    }
+#else
+    goto done;
+
+    //! The same as above, only for cells coversLoop() has already vouched for
+    //! Input is left to the usual handler, the loop then carries on with checks
+fast_ADD:
+    Tape::template rawAt<Cell>(*this, ptr + next->offset) += (Cell)next->value;
+    goto *(++next)->fast;
+fast_MOVE:
+    ptr += next->value;
+    goto *(++next)->fast;
+fast_SET:
+    Tape::template rawAt<Cell>(*this, ptr + next->offset) = (Cell)next->value;
+    goto *(++next)->fast;
+fast_OUT:
+    COutputBuffer::instance().fill((char)Tape::template rawGet<Cell>(*this, ptr + next->offset), next->value);
+    goto *(++next)->fast;
+fast_MULADD:
+{
+    Cell source = Tape::template rawGet<Cell>(*this, ptr + next->source);
+    if (source != 0) {
+        Tape::template rawAt<Cell>(*this, ptr + next->offset) += source * (Cell)next->value;
+    }
+    goto *(++next)->fast;
+}
+fast_OPEN:
+    if (Tape::template rawGet<Cell>(*this, ptr) == 0) {
+        next = code + next->jump + 1;
+        goto *next->fast;
+    }
+    goto *(++next)->fast;
+fast_CLOSE:
+    if (Tape::template rawGet<Cell>(*this, ptr) != 0) {
+        if (nativeReady.load(std::memory_order_relaxed)) {
+            IP = next->jump;
+            curPtrPos = ptr;
+            return;
+        }
+        next = code + next->jump + 1;
+        goto *next->fast;
+    } else if (next == fastExit) {
+        goto *(++next)->handler;
+    }
+    goto *(++next)->fast;
+fast_NOP:
+    goto *(++next)->fast;
+
+done:
+#endif
+
+    IP = next - code;
+    //! A ring tape's pointer may be sitting on a mirror, everything else expects the real cell
+    curPtrPos = Tape::wraps ? WrappedTape::move(*this, ptr) : ptr;
+    keepRunning = false;
+}
+
+#undef CORE_CASE
+#undef CORE_NEXT
+#undef CORE_JUMP
+
+template <typename Cell, typename Tape>
+CVanillaState::Core CVanillaState::pickEOF(ActionOnEOF onEOF)
+{
+    switch (onEOF)
+    {
+    case RETM1:
+        return &CVanillaState::runCore<Cell, Tape, RETM1>;
+    case RET0:
+        return &CVanillaState::runCore<Cell, Tape, RET0>;
+    case NOP:
+        return &CVanillaState::runCore<Cell, Tape, NOP>;
+    default:
+        return &CVanillaState::runCore<Cell, Tape, ABORT>;
+    }
+}
+
+template <typename Cell>
+CVanillaState::Core CVanillaState::pickTape(bool wrapPtr, bool dynamicTape, bool twoWayTape, bool sparseTape, bool ringTape, bool guardedTape, ActionOnEOF onEOF)
+{
+    if (sparseTape) {
+        return pickEOF<Cell, SparseTape>(onEOF);
+    } else if (ringTape) {
+        return pickEOF<Cell, RingTape>(onEOF);
+    } else if (wrapPtr) {
+        return pickEOF<Cell, WrappedTape>(onEOF);
+    } else if (guardedTape) {
+        return pickEOF<Cell, GuardedTape>(onEOF);
+    } else if (twoWayTape) {
+        return pickEOF<Cell, TwoWayTape>(onEOF);
+    } else if (dynamicTape) {
+        return pickEOF<Cell, DynamicTape>(onEOF);
+    }
+    return pickEOF<Cell, BoundedTape>(onEOF);
+}
+
+CVanillaState::Core CVanillaState::pickCore(int size, bool wrapPtr, bool dynamicTape, bool twoWayTape, bool sparseTape, bool ringTape, bool guardedTape, ActionOnEOF onEOF)
+{
+    switch (size)
+    {
+    case 1:
+        return pickTape<uint8_t>(wrapPtr, dynamicTape, twoWayTape, sparseTape, ringTape, guardedTape, onEOF);
+    case 2:
+        return pickTape<uint16_t>(wrapPtr, dynamicTape, twoWayTape, sparseTape, ringTape, guardedTape, onEOF);
+    case 4:
+        return pickTape<uint32_t>(wrapPtr, dynamicTape, twoWayTape, sparseTape, ringTape, guardedTape, onEOF);
+    default:
+        return pickTape<uint64_t>(wrapPtr, dynamicTape, twoWayTape, sparseTape, ringTape, guardedTape, onEOF);
+    }
+}
+
 void CVanillaState::compile(std::ostream& output)
 {
+    //! Whatever runs before the first input is done right here, the generated C starts from the tape, pointer and output it left
+    std::vector<CellType> image = initData;
+    int64_t pointer = 0;
+    std::string printed;
+    unsigned start = 0;
+
+    if (hasPlainRuntime()) {
+        analyzeLoops();
+        if (tuning().optLevel >= 1) {
+            start = evaluatePrefix(instructions.size(), image, pointer, printed);
+            if (start > 0 && start < instructions.size()) {
+                //! Once more just up to there, it may have stopped halfway through a loop
+                start = evaluatePrefix(start, image, pointer, printed);
+            }
+            if (start == instructions.size()) {
+                //! Nothing's left to look at the tape, all that's left of the program is its output
+                image.clear();
+                pointer = 0;
+            }
+            //! Zeros past the data file are what the tape starts with anyway
+            while (image.size() > initData.size() && image.back().c64 == 0) {
+                image.pop_back();
+            }
+        }
+        measureFootprint(start, pointer);
+    } else {
+        loopSpans.clear();
+        footprintKnown = false;
+    }
+    //! The tape image takes the place of the data file for the rest of it
+    initData.swap(image);
+    //! calloc() would zero the whole tape up front, a fixed array only costs the pages that get touched
+    int64_t cells = std::max(footprintHigh + 1, (int64_t)initData.size()) - footprintLow;
+    staticTape = footprintKnown && !sparse && cells*cellSize <= staticTapeBytes;
+
     compilePreMain(output);
     output << "int main() {" << std::endl;
     compilePreInst(output);
 
-    for (auto it = instructions.begin(); it != instructions.end(); it++) {
-        compileInstruction(output, *it);
+    if (pointer != 0) {
+        output << "index = " << pointer << ';' << std::endl;
     }
+    if (!printed.empty()) {
+        output << "writeOutput(";
+        compileString(output, printed);
+        output << ", " << printed.size() << ");" << std::endl;
+    }
+
+    reachLow = reachHigh = 0;
+    unchecked = staticTape;
+    compileBlock(output, start, instructions.size());
+    unchecked = false;
+    initData.swap(image);
 
     compileCleanup(output);
     output << "}" << std::endl;
 }
 
-const IBasicState::CellType CVanillaState::getCell(int cellIndex)
+void CVanillaState::printStats(std::ostream& output) const
+{
+    static const char* const hugeNames[] = { "none", "MAP_HUGETLB", "madvise" };
+
+    output << "Tape: " << cellCount - cellLow << " cells of " << cellSize << " byte(s), ";
+    if (sparse) {
+        output << "kept in sparse pages";
+    } else if (twoWay) {
+        output << "grown both ways, down to cell " << cellLow;
+    } else if (dynamic) {
+        output << "grown as needed";
+    } else if (ring) {
+        output << "wrapping, mapped as a ring";
+    } else if (ptrWrap) {
+        output << "wrapping";
+    } else if (guarded) {
+        output << "bounded by guard pages";
+    } else {
+        output << "bounded";
+    }
+    output << std::endl;
+    if (footprintKnown) {
+        output << "Footprint: cells " << footprintLow << " up to " << footprintHigh << ", whatever the input" << std::endl;
+    }
+    if (!sparse && touchedCells() >= 0) {
+        output << "Touched: cells 0 up to " << touchedCells() << std::endl;
+    }
+    output << "Huge pages: " << (hugePages ? hugeNames[hugeMethod] : "not asked for") << std::endl;
+    CMemoryBudget::instance().report(output);
+}
+
+const IBasicState::CellType CVanillaState::getCell(int64_t cellIndex)
 {
     CellType toReturn = { 0 };
 
-    examineIndex(cellIndex);
+    if (!ring || (uint64_t)(cellIndex + cellCount) >= (uint64_t)(3*cellCount)) {
+        examineIndex(cellIndex);
+    }
 
+    const uint8_t* cell = sparse ? sparseTape.peek(cellIndex) : (uint8_t*)tape + cellIndex*cellSize;
     switch (cellSize)
     {
     case 1:
-        toReturn.c8 = ((uint8_t*)tape)[cellIndex];
+        toReturn.c8 = *(const uint8_t*)cell;
     break;
     case 2:
-        toReturn.c16 = ((uint16_t*)tape)[cellIndex];
+        toReturn.c16 = *(const uint16_t*)cell;
     break;
     case 4:
-        toReturn.c32 = ((uint32_t*)tape)[cellIndex];
+        toReturn.c32 = *(const uint32_t*)cell;
     break;
     case 8:
-        toReturn.c64 = ((uint64_t*)tape)[cellIndex];
+        toReturn.c64 = *(const uint64_t*)cell;
     break;
     }
 
     return toReturn;
 }
 
-void CVanillaState::setCell(int cellIndex, const CellType& newValue)
+void CVanillaState::setCell(int64_t cellIndex, const CellType& newValue)
 {
-    examineIndex(cellIndex);
+    if (!ring || (uint64_t)(cellIndex + cellCount) >= (uint64_t)(3*cellCount)) {
+        examineIndex(cellIndex);
+    }
 
+    uint8_t* cell = sparse ? sparseTape.poke(cellIndex) : (uint8_t*)tape + cellIndex*cellSize;
     switch (cellSize)
     {
     case 1:
-        ((uint8_t*)tape)[cellIndex] = newValue.c8;
+        *(uint8_t*)cell = newValue.c8;
     break;
     case 2:
-        ((uint16_t*)tape)[cellIndex] = newValue.c16;
+        *(uint16_t*)cell = newValue.c16;
     break;
     case 4:
-        ((uint32_t*)tape)[cellIndex] = newValue.c32;
+        *(uint32_t*)cell = newValue.c32;
     break;
     case 8:
-        ((uint64_t*)tape)[cellIndex] = newValue.c64;
+        *(uint64_t*)cell = newValue.c64;
     break;
     }
 }
@@ -278,8 +887,8 @@ void CVanillaState::parseData(std::istream& input)
 
 bool CVanillaState::userInput(uint8_t& c)
 {
-    char temp;
-    if (!std::cin.get(temp)) {
+    uint8_t temp;
+    if (!CInputBuffer::instance().get(temp)) {
         switch (eofPolicy)
         {
         case RETM1:
@@ -301,11 +910,38 @@ bool CVanillaState::userInput(uint8_t& c)
     return true;
 }
 
-void CVanillaState::examineIndex(int& cellIndex)
+void CVanillaState::pushStack(std::vector<CellType>& stack, const CellType& value)
 {
-    if (cellIndex < 0) {
+    //! Grown here instead of by push_back(), so the budget knows the size before the memory is taken
+    if (stack.size() == stack.capacity()) {
+        size_t grown = std::max<size_t>(16, 2*stack.capacity());
+        CMemoryBudget::instance().charge("stack", grown*sizeof(CellType));
+        stack.reserve(grown);
+    }
+    stack.push_back(value);
+}
+
+void CVanillaState::examineIndex(int64_t& cellIndex)
+{
+    if (ptrWrap && (cellCount & (cellCount - 1)) == 0) {
+        //! Page aligned tapes are usually a power of two, a mask does the same as the modulo
+        cellIndex &= cellCount - 1;
+        return;
+    }
+
+    if (cellIndex < cellLow) {
         if (ptrWrap) {
-            cellIndex = cellCount - cellIndex % cellCount;
+            cellIndex = (cellIndex % cellCount + cellCount) % cellCount;
+        } else if (twoWay) {
+            //! Grows left the same way it grows right
+            int64_t newLow = cellLow;
+            while (cellIndex < newLow) {
+                newLow += newLow/2 - 1;
+            }
+            if ((size_t)-newLow*cellSize > tapeRoom()) {
+                newLow = cellIndex;
+            }
+            lowerTape(newLow);
         } else {
             throw std::runtime_error("Pointer was decremented too much.");
         }
@@ -313,16 +949,16 @@ void CVanillaState::examineIndex(int& cellIndex)
 
     if (dynamic) {
         //! Either extend the tape enough or die trying
-        while (cellIndex >= cellCount) {
-            int oldCount = cellCount;
-            cellCount += cellCount/2 + 1;
-
-            tape = realloc(tape, cellCount*cellSize);
-            if (tape == nullptr) {
-                throw std::runtime_error("There's not enough memory available!");
+        if (cellIndex >= cellCount) {
+            int64_t newCount = cellCount;
+            while (cellIndex >= newCount) {
+                newCount += newCount/2 + 1;
             }
-
-            memset((char*)tape + oldCount*cellSize, 0, cellCount*cellSize - oldCount*cellSize);
+            //! Near the end of the reserved range, only commit what's needed
+            if ((size_t)newCount*cellSize > tapeRoom()) {
+                newCount = cellIndex + 1;
+            }
+            resizeTape(newCount);
         }
     } else {
         if (cellIndex >= cellCount) {
@@ -335,100 +971,1669 @@ void CVanillaState::examineIndex(int& cellIndex)
     }
 }
 
-void CVanillaState::compilePreMain(std::ostream& output)
+void CVanillaState::allocTape(int64_t count)
 {
-    using std::endl;
+    if (sparse) {
+        //! Pages come later, as cells get written to
+        tape = tapeStart = nullptr;
+        tapeMapped = 0;
+        cellCount = count;
+        return;
+    } else if (dynamic) {
+        //! Reserved once and committed as the pointer advances, so growing never moves the tape
+        //! Settles for less address space if the system won't give that much
+        size_t reserve = tapeReserve;
+        void* range = MAP_FAILED;
+        while (reserve > (size_t)count*cellSize) {
+            range = mmap(nullptr, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (range != MAP_FAILED) {
+                break;
+            }
+            reserve /= 2;
+        }
+        if (range == MAP_FAILED) {
+            throw std::runtime_error("There's not enough memory available!");
+        }
 
-    output << "#include <stdio.h>" << endl;
-    output << "#include <stdint.h>" << endl;
-    output << "#include <stdlib.h>" << endl;
-    output << "#include <string.h>" << endl;
+        //! Committing it as huge pages would take them all up front, so the kernel is only asked to prefer them
+        if (hugePages && madvise(range, reserve, MADV_HUGEPAGE) == 0) {
+            hugeMethod = HUGE_ADVISED;
+        }
 
-    switch (cellSize)
-    {
-    case 1:
-        output << "typedef uint8_t CellType;" << endl;
-    break;
-    case 2:
-        output << "typedef uint16_t CellType;" << endl;
-    break;
-    case 4:
-        output << "typedef uint32_t CellType;" << endl;
-    break;
-    case 8:
-        output << "typedef uint64_t CellType;" << endl;
-    break;
+        tape = twoWay ? (char*)range + reserve/2 : range;
+        tapeStart = range;
+        tapeMapped = reserve;
+        resizeTape(count);
+        return;
     }
 
-    if (dynamic) {
-        output << "void* incReallocPtr(void* p, int* size, int index) {" << endl;
-        output << "p = realloc(p, (index+1)*sizeof(CellType));" << endl;
-        output << "if (!p) {" << endl;
-        output << "fputs(\"Error: Out of memory!\\n\", stderr);" << endl;
-        output << "exit(-1);" << endl;
-        output << "}" << endl;
-        output << "memset((char*)p+*size*sizeof(CellType), 0, ((index+1)-*size)*sizeof(CellType));" << endl;
-        output << "*size = index+1;" << endl;
-        output << "return p;" << endl;
-        output << "}" << endl;
-    }
-    if (!ptrWrap) {
-        output << "void incError() {" << endl;
-        output << "fputs(\"Error: Tried to increment pointer beyond upper bound.\\n\", stderr);" << endl;
-        output << "exit(-1);" << endl;
-        output << "}" << endl;
-        output << "void decError() {" << endl;
-        output << "fputs(\"Error: Tried to decrement pointer beyond lower bound.\\n\", stderr);" << endl;
-        output << "exit(-1);" << endl;
-        output << "}" << endl;
+    //! The whole tape counts, even though only what gets written to is ever committed
+    CMemoryBudget::instance().charge("tape", count*cellSize);
+    if (ptrWrap && mapRing(count)) {
+        return;
+    } else if (!ptrWrap && mapGuarded(count)) {
+        return;
     }
 
-    output << "void getInput(CellType* dst) {" << endl;
-    output << "int temp = getchar();" << endl;
-    output << "if (temp == EOF) {" << endl;
-    switch (eofPolicy)
-    {
-    case RETM1:
-        output << "*dst = -1;" << endl;
-    break;
-    case RET0:
-        output << "*dst = 0;" << endl;
-    break;
-    case NOP:
-    break;
-    case ABORT:
-        output << "fputs(\"Error: Encountered EOF while processing input.\", stderr);" << endl;
-        output << "exit(-1);" << endl;
-    break;
+    //! Only address space is reserved here, nothing is committed until it's written to
+    tape = mmap(nullptr, count*cellSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (tape == MAP_FAILED) {
+        tape = nullptr;
+        throw std::runtime_error("There's not enough memory available!");
     }
-    output << "} else {" << endl;
-    output << "*dst = (CellType)temp;" << endl;
-    output << "}" << endl;
-    output << "}" << endl;
+    tapeStart = tape;
+    tapeMapped = count*cellSize;
+    cellCount = count;
+    backWithHugePages(tape, tapeMapped);
+}
 
-    if (!initData.empty()) {
-        output << "const CellType datArray[] = { ";
-        for (CellType cell : initData) {
-            output << "0x" << std::hex << cell.c64 << ',';
+void CVanillaState::resizeTape(int64_t count)
+{
+    size_t bytes = count*cellSize;
+
+    if (sparse) {
+        //! Nothing to commit, only the bounds change
+    } else if (dynamic) {
+        CMemoryBudget::instance().charge("tape", (count - cellLow)*cellSize);
+        if (bytes > tapeRoom() || mprotect(tape, bytes, PROT_READ | PROT_WRITE) != 0) {
+            throw std::runtime_error("There's not enough memory available!");
+        }
+    } else if (ring || guarded || hugeMethod == HUGE_TLB) {
+        //! None can simply be stretched, the tape is mapped anew and the cells copied over
+        void* oldTape = tape;
+        void* oldStart = tapeStart;
+        size_t oldMapped = tapeMapped;
+        size_t kept = std::min(bytes, (size_t)cellCount*cellSize);
+
+        ring = guarded = false;
+        hugeMethod = HUGE_NONE;
+        allocTape(count);
+        memcpy(tape, oldTape, kept);
+        munmap(oldStart, oldMapped);
+        return;
+    } else {
+        CMemoryBudget::instance().charge("tape", bytes);
+        void* newTape = mremap(tape, tapeMapped, bytes, MREMAP_MAYMOVE);
+        if (newTape == MAP_FAILED) {
+            throw std::runtime_error("There's not enough memory available!");
         }
-        output << '\b' << " };" << endl;
+        tape = tapeStart = newTape;
+        tapeMapped = bytes;
     }
+    cellCount = count;
 }
 
-void CVanillaState::compilePreInst(std::ostream& output)
+void CVanillaState::lowerTape(int64_t low)
 {
-    using std::endl;
-    using std::max;
+    if (sparse) {
+        cellLow = low;
+        return;
+    }
+
+    //! mprotect() wants a page aligned start, so whatever else shares the first page comes along
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)tape + low*cellSize) & ~(pageSize - 1);
+
+    CMemoryBudget::instance().charge("tape", (uintptr_t)tape + cellCount*cellSize - start);
+    if ((size_t)-low*cellSize > tapeRoom() || mprotect((void*)start, (uintptr_t)tape - start, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error("There's not enough memory available!");
+    }
+    cellLow = ((intptr_t)start - (intptr_t)tape)/cellSize;
+}
+
+void CVanillaState::freeTape()
+{
+    if (tapeStart) {
+        munmap(tapeStart, tapeMapped);
+        tape = tapeStart = nullptr;
+    }
+}
+
+int64_t CVanillaState::touchedCells() const
+{
+    if (!tape) {
+        return -1;
+    }
+
+    //! Pages only become resident once the program gets to them, the last one tells how far it went
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)tape & ~(pageSize - 1);
+    size_t length = (uintptr_t)tape + cellCount*cellSize - start;
+    std::vector<unsigned char> resident((length + pageSize - 1)/pageSize);
+
+    if (mincore((void*)start, length, resident.data()) != 0) {
+        return -1;
+    }
+    for (size_t i = resident.size(); i > 0; --i) {
+        if (resident[i - 1] & 1) {
+            return std::min<int64_t>(cellCount, (int64_t)(start + i*pageSize - (uintptr_t)tape)/cellSize);
+        }
+    }
+    return 0;
+}
+
+bool CVanillaState::mapGuarded(int64_t count)
+{
+    size_t bytes = count*cellSize;
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t pages = (bytes + pageSize - 1) & ~(pageSize - 1);
+
+    void* range = mmap(nullptr, pages + 2*guardBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (range == MAP_FAILED) {
+        return false;
+    } else if (mprotect((char*)range + guardBytes, pages, PROT_READ | PROT_WRITE) != 0) {
+        munmap(range, pages + 2*guardBytes);
+        return false;
+    }
+
+    tapeStart = range;
+    tapeMapped = pages + 2*guardBytes;
+    tape = (char*)range + guardBytes + (pages - bytes);
+    cellCount = count;
+    guarded = true;
+    guardFloor = pages == bytes ? std::numeric_limits<int64_t>::min() : 0;
+    guardCells = guardBytes/cellSize/2;
+    backWithHugePages((char*)range + guardBytes, pages);
+    return true;
+}
+
+void CVanillaState::backWithHugePages(void* at, size_t bytes)
+{
+    if (!hugePages) {
+        return;
+    }
+
+    //! MAP_HUGETLB needs aligned addresses, whatever sticks out on either side stays on regular pages
+    uintptr_t start = ((uintptr_t)at + hugePageBytes - 1) & ~(uintptr_t)(hugePageBytes - 1);
+    uintptr_t end = ((uintptr_t)at + bytes) & ~(uintptr_t)(hugePageBytes - 1);
+
+    //! A failed MAP_FIXED can leave a hole where the tape was, so there has to be enough of them before trying that
+    void* probe = start < end ? mmap(nullptr, end - start, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0) : MAP_FAILED;
+    if (probe != MAP_FAILED) {
+        munmap(probe, end - start);
+        if (mmap((void*)start, end - start, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) != MAP_FAILED) {
+            hugeMethod = HUGE_TLB;
+            return;
+        }
+        //! Someone else took them in between, regular pages go back in their place
+        if (mmap((void*)start, end - start, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) {
+            throw std::runtime_error("There's not enough memory available!");
+        }
+    }
+    if (madvise(at, bytes, MADV_HUGEPAGE) == 0) {
+        hugeMethod = HUGE_ADVISED;
+    }
+}
+
+void CVanillaState::guardFault(int, siginfo_t* info, void*)
+{
+    CVanillaState* owner = guardOwner;
+    uintptr_t address = (uintptr_t)info->si_addr;
+
+    if (owner && address >= (uintptr_t)owner->tapeStart && address < (uintptr_t)owner->tapeStart + owner->tapeMapped) {
+        siglongjmp(owner->guardJump, address < (uintptr_t)owner->tape ? -1 : 1);
+    }
+    //! Not ours, the fault happens again on return and takes the process down like it would have
+    signal(SIGSEGV, SIG_DFL);
+}
+
+bool CVanillaState::mapRing(int64_t count)
+{
+    size_t bytes = count*cellSize;
+    if (bytes % sysconf(_SC_PAGESIZE) != 0) {
+        return false;
+    }
+
+    //! A memfd is the only way to have the same pages show up at more than one address
+    int fd = memfd_create("bfk-tape", MFD_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    void* range = MAP_FAILED;
+    if (ftruncate(fd, bytes) == 0) {
+        range = mmap(nullptr, 3*bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    bool mapped = range != MAP_FAILED;
+    for (int i = 0; mapped && i < 3; ++i) {
+        mapped = mmap((char*)range + i*bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+    }
+    close(fd);
+
+    if (!mapped) {
+        if (range != MAP_FAILED) {
+            munmap(range, 3*bytes);
+        }
+        return false;
+    }
+
+    tape = (char*)range + bytes;
+    tapeStart = range;
+    tapeMapped = 3*bytes;
+    cellCount = count;
+    ring = true;
+    //! Shared memory, only taken as a hint if the system allows huge pages for it at all
+    if (hugePages && madvise(range, 3*bytes, MADV_HUGEPAGE) == 0) {
+        hugeMethod = HUGE_ADVISED;
+    }
+    return true;
+}
+
+CVanillaState::BFinstr::BFinstr(char t)
+: op(OP_EXT), token(t), offset(0), source(0), value(1), jump(-1)
+{
+    switch (t)
+    {
+    case '+':
+        op = OP_ADD;
+    break;
+    case '-':
+        op = OP_ADD;
+        value = -1;
+    break;
+    case '>':
+        op = OP_MOVE;
+    break;
+    case '<':
+        op = OP_MOVE;
+        value = -1;
+    break;
+    case '.':
+        op = OP_OUT;
+    break;
+    case ',':
+        op = OP_IN;
+    break;
+    case '[':
+        op = OP_OPEN;
+    break;
+    case ']':
+        op = OP_CLOSE;
+    break;
+    }
+}
+
+void CVanillaState::pushInstr(const BFinstr& instr)
+{
+    if (!instructions.empty()) {
+        BFinstr& last = instructions.back();
+        bool sameKind = last.op == instr.op && last.offset == instr.offset;
+
+        bool sameCell = last.offset == instr.offset;
+
+        if (sameKind && (instr.op == OP_ADD || instr.op == OP_MOVE)) {
+            last.value += instr.value;
+            //! Things like "+-" or "<>" cancel out completely
+            if (last.value == 0) {
+                instructions.pop_back();
+            }
+            return;
+        } else if (sameKind && instr.op == OP_EXT && last.token == instr.token && foldsToken(instr.token)) {
+            last.value += instr.value;
+            return;
+        } else if (sameKind && instr.op == OP_OUT && hasPlainRuntime()) {
+            //! ".." prints the same character twice, in one go
+            last.value += instr.value;
+            return;
+        } else if (sameCell && last.op == OP_SET && instr.op == OP_ADD) {
+            //! "[-]+++" ends up as a single SET
+            last.value += instr.value;
+            return;
+        } else if (sameCell && (last.op == OP_ADD || last.op == OP_SET) && instr.op == OP_SET) {
+            //! Whatever was there gets overwritten anyway
+            last = instr;
+            return;
+        }
+    }
+    instructions.push_back(instr);
+}
+
+//! Inverse of an odd number, modulo 2^64( and so modulo any smaller power of two )
+static uint64_t oddInverse(uint64_t a)
+{
+    uint64_t x = a; //! Already correct for the lowest 3 bits
+    for (int i = 0; i < 5; i++) {
+        x *= 2 - a*x;
+    }
+    return x;
+}
+
+void CVanillaState::optimize()
+{
+    if (tuning().optLevel >= 1) {
+        replaceIdioms();
+    }
+    if (tuning().optLevel >= 2) {
+        foldMoves();
+    }
+    if (tuning().optLevel >= 1 && cellSize == 1 && hasPlainRuntime()) {
+        replaceInputLoops();
+    }
+}
+
+void CVanillaState::replaceIdioms()
+{
+    const int cellBits = cellSize*8;
+    const uint64_t cellMask = cellBits == 64 ? ~(uint64_t)0 : ((uint64_t)1 << cellBits) - 1;
+
+    std::vector<BFinstr> source;
+    source.swap(instructions);
+    instructions.reserve(source.size());
+
+    for (const BFinstr& instr : source) {
+        pushInstr(instr);
+        if (instr.op != OP_CLOSE) {
+            continue;
+        }
+
+        //! Only innermost loops made of nothing but ADD and MOVE are candidates
+        size_t open = instructions.size() - 1;
+        while (open > 0 && (instructions[open-1].op == OP_ADD || instructions[open-1].op == OP_MOVE)) {
+            --open;
+        }
+        if (open == 0 || instructions[open-1].op != OP_OPEN) {
+            continue;
+        }
+        --open;
+        if (keepsLoop(open)) {
+            continue;
+        }
+
+        std::map<int, uint64_t> deltas;
+        int64_t pos = 0;
+        for (size_t i = open+1; i < instructions.size()-1; i++) {
+            if (instructions[i].op == OP_ADD) {
+                deltas[pos + instructions[i].offset] += instructions[i].value;
+            } else {
+                pos += instructions[i].value;
+            }
+        }
+
+        std::vector<BFinstr> idiom;
+        if (deltas.empty() && pos != 0) {
+            //! [>], [<<] and the like
+            idiom.push_back(BFinstr(0, OP_SCAN, pos));
+        } else if (pos == 0 && (deltas[0] & 1)) {
+            //! The loop runs 'cell * inverse(-delta)' times, no matter how the cell wraps around
+            uint64_t times = oddInverse(-deltas[0]);
+            for (auto& delta : deltas) {
+                uint64_t factor = (delta.second * times) & cellMask;
+                if (delta.first == 0 || factor == 0) {
+                    continue;
+                }
+                //! Keeps factors readable, -1 instead of 255
+                int64_t value = factor;
+                if (cellBits < 64 && (factor >> (cellBits-1))) {
+                    value = (int64_t)factor - ((int64_t)1 << cellBits);
+                }
+                BFinstr mul(0, OP_MULADD, value);
+                mul.offset = delta.first;
+                idiom.push_back(mul);
+            }
+            idiom.push_back(BFinstr(0, OP_SET, 0));
+        } else {
+            continue;
+        }
+
+        instructions.erase(instructions.begin() + open, instructions.end());
+        for (const BFinstr& replacement : idiom) {
+            pushInstr(replacement);
+        }
+    }
+}
+
+void CVanillaState::foldMoves()
+{
+    std::vector<BFinstr> source;
+    source.swap(instructions);
+    instructions.reserve(source.size());
+
+    int64_t pos = 0; //! How far the pointer would have moved since the block started
+
+    for (BFinstr instr : source) {
+        switch (instr.op)
+        {
+        case OP_MOVE:
+            pos += instr.value;
+        break;
+        case OP_ADD:
+        case OP_SET:
+        case OP_IN:
+        case OP_OUT:
+        case OP_MULADD:
+            instr.offset += pos;
+            instr.source += pos;
+            pushInstr(instr);
+        break;
+        default:
+            //! Anything else either jumps or expects the pointer in place
+            if (pos != 0) {
+                pushInstr(BFinstr('>', OP_MOVE, pos));
+                pos = 0;
+            }
+            pushInstr(instr);
+        break;
+        }
+    }
+    if (pos != 0) {
+        pushInstr(BFinstr('>', OP_MOVE, pos));
+    }
+}
+
+void CVanillaState::replaceInputLoops()
+{
+    std::vector<BFinstr> source;
+    source.swap(instructions);
+    instructions.reserve(source.size());
+
+    for (size_t i = 0; i < source.size(); i++) {
+        //! The loop has to be '[', an optional ADD, an optional OUT, IN, an optional ADD and ']', all on the same cell
+        size_t k = i + 1;
+        auto next = [&](OpCode op) {
+            return k < source.size() && source[k].op == op && source[k].offset == 0;
+        };
+        int64_t before = 0, after = 0;
+        bool echo = false;
+
+        if (source[i].op == OP_OPEN) {
+            if (next(OP_ADD)) {
+                before = source[k++].value;
+            }
+            if (next(OP_OUT) && source[k].value == 1) {
+                echo = true;
+                ++k;
+            }
+            if (next(OP_IN)) {
+                ++k;
+                if (next(OP_ADD)) {
+                    after = source[k++].value;
+                }
+                //! Only a loop that prints exactly what it reads can be done in bulk
+                if (k < source.size() && source[k].op == OP_CLOSE && (!echo || ((before + after) & 0xFF) == 0)) {
+                    instructions.push_back(BFinstr(0, echo ? OP_COPY : OP_SKIP, -after & 0xFF));
+                }
+            }
+        }
+        instructions.push_back(source[i]);
+    }
+}
+
+uint8_t CVanillaState::feedLoop(uint8_t cell, uint8_t value, bool echo)
+{
+    CInputBuffer& input = CInputBuffer::instance();
+    COutputBuffer& output = COutputBuffer::instance();
+    const uint8_t* bytes;
+    size_t count;
+
+    //! Every character up to the one that ends the loop gets printed by the round after the one that read it
+    while (cell != 0 && (count = input.available(bytes)) > 0) {
+        const uint8_t* found = (const uint8_t*)memchr(bytes, value, count);
+        size_t used = found ? found - bytes + 1 : count;
+        if (echo) {
+            output.put(cell + value);
+            output.write((const char*)bytes, used - 1);
+        }
+        cell = bytes[used - 1] - value;
+        input.consume(used);
+    }
+    return cell;
+}
+
+void CVanillaState::linkJumps(char open, char close)
+{
+    std::vector<int> opened;
+
+    for (unsigned i = 0; i < instructions.size(); i++) {
+        if (instructions[i].token == open) {
+            opened.push_back(i);
+        } else if (instructions[i].token == close) {
+            if (opened.empty()) {
+                throw std::runtime_error(std::string("Found \'") + close + "\' before its matching \'" + open + "\'.");
+            }
+            instructions[i].jump = opened.back();
+            instructions[opened.back()].jump = i;
+            opened.pop_back();
+        }
+    }
+}
+
+void CVanillaState::analyzeLoops()
+{
+    loopSpans.assign(instructions.size(), LoopSpan{ false, 0, 0 });
+
+    //! Going backwards, inner loops are always worked out before the ones around them
+    for (unsigned i = instructions.size(); i-- > 0;) {
+        if (instructions[i].op != OP_OPEN) {
+            continue;
+        }
+
+        LoopSpan span;
+        int64_t shift;
+        span.balanced = measureSpan(i + 1, instructions[i].jump, span, shift) && shift == 0;
+        loopSpans[i] = span;
+    }
+}
+
+bool CVanillaState::measureSpan(unsigned begin, unsigned end, LoopSpan& span, int64_t& shift) const
+{
+    //! A loop's own condition reads the cell it starts at
+    span.low = span.high = 0;
+    shift = 0;
+    auto touch = [&span](int64_t cell) {
+        span.low = std::min(span.low, cell);
+        span.high = std::max(span.high, cell);
+    };
+
+    for (unsigned k = begin; k < end; k++) {
+        const BFinstr& instr = instructions[k];
+        switch (instr.op)
+        {
+        case OP_NOP:
+        break;
+        case OP_MOVE:
+            shift += instr.value;
+        break;
+        case OP_ADD:
+        case OP_SET:
+        case OP_IN:
+        case OP_OUT:
+        case OP_COPY:
+        case OP_SKIP:
+            touch(shift + instr.offset);
+        break;
+        case OP_MULADD:
+            touch(shift + instr.source);
+            touch(shift + instr.offset);
+        break;
+        case OP_OPEN:
+            //! Whatever an inner loop does, it's done by the time it ends
+            if (!loopSpans[k].balanced) {
+                return false;
+            }
+            touch(shift + loopSpans[k].low);
+            touch(shift + loopSpans[k].high);
+            k = instr.jump;
+        break;
+        default:
+            //! Scans go as far as they need to, and nothing's known about variant specific commands
+            return false;
+        }
+    }
+    return true;
+}
+
+void CVanillaState::measureFootprint(unsigned begin, int64_t pointer)
+{
+    LoopSpan span;
+    int64_t shift;
+
+    //! Cells before 'begin' are only ever from 0 up, whatever the rest does
+    footprintKnown = measureSpan(begin, instructions.size(), span, shift) &&
+                     (pointer + span.low >= 0 || twoWay) && (pointer + span.high < cellCount || dynamic);
+    footprintLow = std::min((int64_t)0, pointer + span.low);
+    footprintHigh = std::max((int64_t)0, pointer + span.high);
+}
+
+unsigned CVanillaState::evaluatePrefix(unsigned stopAt, std::vector<CellType>& cells, int64_t& pointer, std::string& printed) const
+{
+    const uint64_t mask = cellSize == 8 ? ~(uint64_t)0 : ((uint64_t)1 << cellSize*8) - 1;
+    //! Anything past the tape it starts with would have to grow it or fail, which is left to run time
+    const int64_t limit = std::min(std::max(cellCount, (int64_t)initData.size()), evaluateBytes/cellSize);
+
+    cells = initData;
+    pointer = 0;
+    printed.clear();
+
+    auto cell = [&](int64_t index) -> CellType* {
+        if (ptrWrap) {
+            index = (index % cellCount + cellCount) % cellCount;
+        }
+        if (index < 0 || index >= limit) {
+            return nullptr;
+        }
+        if (index >= (int64_t)cells.size()) {
+            cells.resize(index + 1, CellType{0});
+        }
+        return &cells[index];
+    };
+    auto move = [&](int64_t amount) {
+        pointer += amount;
+        if (ptrWrap) {
+            pointer = (pointer % cellCount + cellCount) % cellCount;
+        }
+        return pointer >= 0 && pointer < limit;
+    };
+
+    unsigned top = 0;
+    int depth = 0;
+    uint64_t steps = 0;
+    for (unsigned ip = 0; ip < instructions.size(); ip++) {
+        const BFinstr& instr = instructions[ip];
+        if (depth == 0) {
+            top = ip;
+            if (ip >= stopAt) {
+                return top;
+            }
+        }
+        if (++steps > evaluateSteps) {
+            return top;
+        }
+
+        switch (instr.op)
+        {
+        case OP_NOP:
+        break;
+        case OP_MOVE:
+            if (!move(instr.value)) {
+                return top;
+            }
+        break;
+        case OP_ADD:
+        case OP_SET:
+        {
+            CellType* target = cell(pointer + instr.offset);
+            if (!target) {
+                return top;
+            }
+            target->c64 = ((instr.op == OP_ADD ? target->c64 : 0) + instr.value) & mask;
+        }
+        break;
+        case OP_MULADD:
+        {
+            //! Either one may grow the vector, so the first is read before asking for the second
+            CellType* source = cell(pointer + instr.source);
+            if (!source) {
+                return top;
+            }
+            uint64_t factor = source->c64;
+            CellType* target = cell(pointer + instr.offset);
+            if (!target) {
+                return top;
+            }
+            target->c64 = (target->c64 + factor*instr.value) & mask;
+        }
+        break;
+        case OP_OUT:
+        {
+            CellType* source = cell(pointer + instr.offset);
+            if (!source || (int64_t)printed.size() + instr.value > evaluateBytes) {
+                return top;
+            }
+            printed.append(instr.value, (char)source->c8);
+        }
+        break;
+        case OP_SCAN:
+            for (;;) {
+                CellType* current = cell(pointer);
+                if (!current || ++steps > evaluateSteps) {
+                    return top;
+                }
+                if (current->c64 == 0) {
+                    break;
+                }
+                if (!move(instr.value)) {
+                    return top;
+                }
+            }
+        break;
+        case OP_OPEN:
+        case OP_CLOSE:
+        {
+            CellType* current = cell(pointer);
+            if (!current || instr.jump < 0) {
+                return top;
+            }
+            //! Entering a loop or leaving one, otherwise it jumps and stays at the same depth
+            if (instr.op == OP_OPEN) {
+                if (current->c64 != 0) {
+                    ++depth;
+                } else {
+                    ip = instr.jump;
+                }
+            } else {
+                if (current->c64 != 0) {
+                    ip = instr.jump;
+                } else {
+                    --depth;
+                }
+            }
+        }
+        break;
+        default:
+            //! Input, and anything a variant added
+            return top;
+        }
+    }
+    return instructions.size();
+}
+
+template <typename Tape>
+bool CVanillaState::coversLoop(int64_t index, const LoopSpan& span)
+{
+    int64_t low = index + span.low;
+    int64_t high = index + span.high;
+
+    //! Bounds that would be an error have to be left to the checks, so they come up at the right moment
+    if (Tape::wraps || (low < cellLow && !twoWay) || (high >= cellCount && !dynamic)) {
+        return false;
+    }
+    //! Growing early makes no difference, new cells read as zero either way
+    Tape::reach(*this, low);
+    Tape::reach(*this, high);
+    return true;
+}
+
+std::string CVanillaState::describe(const BFinstr& instr)
+{
+    std::ostringstream output;
+
+    switch (instr.op)
+    {
+    case OP_ADD:
+        output << (instr.value < 0 ? '-' : '+');
+    break;
+    case OP_MOVE:
+        output << (instr.value < 0 ? '<' : '>');
+    break;
+    case OP_SET:
+        output << "= " << instr.value;
+    break;
+    case OP_SCAN:
+        output << "scan " << std::showpos << instr.value << std::noshowpos;
+    break;
+    case OP_MULADD:
+        output << "+= cell";
+        if (instr.source != 0) {
+            output << " @" << std::showpos << instr.source << std::noshowpos;
+        }
+        output << " * " << instr.value;
+    break;
+    case OP_COPY:
+        output << "copy input until " << instr.value;
+    break;
+    case OP_SKIP:
+        output << "skip input until " << instr.value;
+    break;
+    default:
+        output << instr.token;
+    }
+
+    int64_t count = instr.value < 0 ? -instr.value : instr.value;
+    if ((instr.op == OP_ADD || instr.op == OP_MOVE || instr.op == OP_OUT || instr.op == OP_EXT) && count > 1) {
+        output << " x" << count;
+    }
+    if (instr.offset != 0) {
+        output << " @" << std::showpos << instr.offset;
+    }
+
+    return output.str();
+}
+
+std::string CVanillaState::cellAt(int offset, bool write) const
+{
+    std::ostringstream index;
+
+    if (offset == 0) {
+        index << "index";
+    } else if (mirrored() && offset >= -cellCount && offset <= cellCount) {
+        //! The pointer never leaves the tape itself, so this lands on a mirror at worst
+        index << "index" << std::showpos << offset;
+    } else if (ptrWrap && offset > 0) {
+        index << "(index + " << offset << ") % " << cellCount;
+    } else if (ptrWrap) {
+        index << "((index - " << -offset << ") % " << cellCount << " + " << cellCount << ") % " << cellCount;
+    } else {
+        index << "index" << std::showpos << offset;
+    }
+
+    if (sparse) {
+        return "(*sparseCell(" + index.str() + ", " + (write ? "1" : "0") + "))";
+    }
+    return "p[" + index.str() + "]";
+}
+
+void CVanillaState::compileString(std::ostream& output, const std::string& text)
+{
+    output << '"';
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        if (c == '"' || c == '\\' || c == '?') {
+            //! '?' too, so nothing ends up a trigraph
+            output << '\\' << c;
+        } else if (c >= ' ' && c <= '~') {
+            output << c;
+        } else if (c == '\n') {
+            output << "\\n";
+        } else {
+            //! Always three digits, so a digit after it can't be taken as part of it
+            output << '\\' << (char)('0' + (c >> 6)) << (char)('0' + (c >> 3 & 7)) << (char)('0' + (c & 7));
+        }
+        if (c == '\n' && i + 1 < text.size()) {
+            output << '"' << std::endl << '"';
+        }
+    }
+    output << '"';
+}
+
+void CVanillaState::compileMove(std::ostream& output, int64_t amount)
+{
+    using std::endl;
+
+    if (unchecked) {
+        if (amount > 0) {
+            output << "index += " << amount << ';' << endl;
+        } else {
+            output << "index -= " << -amount << ';' << endl;
+        }
+        return;
+    }
+
+    //! Left to the guards, as long as the pointer can't get far enough for an offset to skip one
+    if ((amount > 0 && guardHigh) || (amount < 0 && guardLow)) {
+        if (amount > 0 && amount <= guardBytes/cellSize/4) {
+            output << "index += " << amount << ';' << endl;
+            return;
+        } else if (amount < 0 && -amount <= guardBytes/cellSize/4) {
+            output << "index -= " << -amount << ';' << endl;
+            return;
+        }
+    }
+
+    if (mirrored() && amount >= -cellCount && amount <= cellCount) {
+        //! No need for a division, the pointer is at most one tape length away from where it should be
+        output << "index += " << amount << ';' << endl;
+        if ((cellCount & (cellCount - 1)) == 0) {
+            output << "index &= " << cellCount - 1 << ';' << endl;
+        } else if (amount > 0) {
+            output << "if (index >= " << cellCount << ") {" << endl;
+            output << "index -= " << cellCount << ';' << endl;
+            output << "}" << endl;
+        } else {
+            output << "if (index < 0) {" << endl;
+            output << "index += " << cellCount << ';' << endl;
+            output << "}" << endl;
+        }
+        return;
+    }
+
+    if (amount > 0) {
+        if (ptrWrap) {
+            output << "index = (index + " << amount << ") % " << cellCount << ';' << endl;
+        } else {
+            output << "index += "<< amount << ';' << endl;
+            output << "if (index >= size) {" << endl;
+            if (dynamic) {
+                output << "p = incReallocPtr(p, &size, index);" << endl;
+            } else {
+                output << "incError();" << endl;
+            }
+            output << "}" << endl;
+        }
+    } else {
+        output << "index -= " << -amount << ';' << endl;
+        if (twoWay) {
+            output << "if (index < low) {" << endl;
+            output << "p = decReallocPtr(p, &low, index);" << endl;
+            output << "}" << endl;
+            return;
+        }
+        output << "if (index < 0) {" << endl;
+        if (ptrWrap) {
+            output << "index = " << cellCount << " + index % " << cellCount << ';' << endl;
+        } else {
+            output << "decError();" << endl;
+        }
+        output << "}" << endl;
+    }
+}
+
+void CVanillaState::compileReach(std::ostream& output, int offset)
+{
+    using std::endl;
+
+    //! Wrapping cells are always reachable, cellAt() takes care of them, guards catch what isn't
+    if (unchecked || ptrWrap || (offset >= reachLow && offset <= reachHigh)) {
+        return;
+    } else if ((offset > 0 && guardHigh) || (offset < 0 && guardLow)) {
+        return;
+    }
+
+    if (offset > 0) {
+        reachHigh = offset;
+        output << "if (index + " << offset << " >= size) {" << endl;
+        if (dynamic) {
+            output << "p = incReallocPtr(p, &size, index + " << offset << ");" << endl;
+        } else {
+            output << "incError();" << endl;
+        }
+        output << "}" << endl;
+    } else {
+        reachLow = offset;
+        if (twoWay) {
+            output << "if (index - " << -offset << " < low) {" << endl;
+            output << "p = decReallocPtr(p, &low, index - " << -offset << ");" << endl;
+        } else {
+            output << "if (index < " << -offset << ") {" << endl;
+            output << "decError();" << endl;
+        }
+        output << "}" << endl;
+    }
+}
+
+void CVanillaState::compileBlock(std::ostream& output, unsigned begin, unsigned end)
+{
+    for (unsigned i = begin; i < end; i++) {
+        if (instructions[i].op == OP_OPEN && !unchecked && !ptrWrap && i < loopSpans.size() && loopSpans[i].balanced) {
+            compileBalanced(output, i);
+            i = instructions[i].jump;
+        } else {
+            compileInstruction(output, instructions[i]);
+        }
+    }
+}
+
+void CVanillaState::compileBalanced(std::ostream& output, unsigned open)
+{
+    using std::endl;
+
+    const LoopSpan& span = loopSpans[open];
+    unsigned close = instructions[open].jump;
+    std::ostringstream bounds;
+
+    //! Growing is done up front, going out of bounds has to wait for the checks so the error comes up at the right moment
+    if (span.high > 0 && dynamic) {
+        output << "if (index + " << span.high << " >= size) {" << endl;
+        output << "p = incReallocPtr(p, &size, index + " << span.high << ");" << endl;
+        output << "}" << endl;
+    } else if (span.high > 0 && !guardHigh) {
+        bounds << "index + " << span.high << " < size";
+    }
+    if (span.low < 0 && twoWay) {
+        output << "if (index - " << -span.low << " < low) {" << endl;
+        output << "p = decReallocPtr(p, &low, index - " << -span.low << ");" << endl;
+        output << "}" << endl;
+    } else if (span.low < 0 && !guardLow) {
+        bounds << (bounds.tellp() > 0 ? " && " : "") << "index >= " << -span.low;
+    }
+
+    if (bounds.tellp() > 0) {
+        output << "if (" << bounds.str() << ") {" << endl;
+    }
+    unchecked = true;
+    compileBlock(output, open, close + 1);
+    unchecked = false;
+    if (bounds.tellp() > 0) {
+        output << "} else {" << endl;
+        compileInstruction(output, instructions[open]);
+        compileBlock(output, open + 1, close + 1);
+        output << "}" << endl;
+    }
+}
+
+void CVanillaState::compileResumable(std::ostream& output)
+{
+    using std::endl;
+
+    hostedTape = true;
+    compilePreMain(output);
+
+    output << "void bfkResume(void** tape, int64_t* tapeLow, int64_t* tapeSize, int64_t* tapeIndex, int64_t start, "
+           << "void* (*grow)(void*, int64_t*, int64_t), void* (*growLeft)(void*, int64_t*, int64_t), int (*input)(void), void (*writeBack)(const char*, int64_t), void (*bounds)(int)) {" << endl;
+    output << "CellType* p = *tape;" << endl;
+    if (!ptrWrap) {
+        output << "hostBounds = bounds;" << endl;
+    }
+    output << "readInput = input;" << endl;
+    output << "hostOutput = writeBack;" << endl;
+    output << "int64_t size = *tapeSize;" << endl;
+    output << "int64_t index = *tapeIndex;" << endl;
+    if (dynamic) {
+        output << "incReallocPtr = grow;" << endl;
+    }
+    if (twoWay) {
+        output << "int64_t low = *tapeLow;" << endl;
+        output << "decReallocPtr = growLeft;" << endl;
+    }
+
+    output << "switch (start) {" << endl;
+    for (unsigned i = 0; i < instructions.size(); i++) {
+        if (instructions[i].op == OP_OPEN) {
+            output << "case " << i << ": goto loop" << i << ';' << endl;
+        }
+    }
+    output << "}" << endl;
+
+    reachLow = reachHigh = 0;
+    for (unsigned i = 0; i < instructions.size(); i++) {
+        if (instructions[i].op == OP_OPEN) {
+            output << "loop" << i << ':' << endl;
+        }
+        compileInstruction(output, instructions[i]);
+    }
+
+    output << "*tape = p;" << endl;
+    if (twoWay) {
+        output << "*tapeLow = low;" << endl;
+    }
+    output << "*tapeSize = size;" << endl;
+    output << "*tapeIndex = index;" << endl;
+    output << "}" << endl;
+    hostedTape = false;
+}
+
+void CVanillaState::compilePreMain(std::ostream& output)
+{
+    using std::endl;
+
+    //! Only plain vanilla code is sure to touch the tape between any two moves, which is what keeps the pointer near the guards
+    int64_t cells = std::max(cellCount, (int64_t)initData.size());
+    guardHigh = !hostedTape && !staticTape && !ptrWrap && !dynamic && !sparse && hasPlainRuntime();
+    guardLow = guardHigh && cells*cellSize % sysconf(_SC_PAGESIZE) == 0;
+
+    if (mirrored() && !hostedTape) {
+        //! For memfd_create()
+        output << "#define _GNU_SOURCE" << endl;
+    }
+    output << "#include <errno.h>" << endl;
+    output << "#include <stdio.h>" << endl;
+    output << "#include <stdint.h>" << endl;
+    output << "#include <stdlib.h>" << endl;
+    output << "#include <string.h>" << endl;
+    output << "#include <unistd.h>" << endl;
+    //! Same as the interpreter, asked for once the tape is there and silently done without if not possible
+    bool huge = hugePages && !hostedTape && !sparse && !staticTape;
+
+    if (dynamic || mirrored() || guardHigh || huge) {
+        output << "#include <sys/mman.h>" << endl;
+    }
+    if (guardHigh) {
+        output << "#include <signal.h>" << endl;
+    }
+
+    switch (cellSize)
+    {
+    case 1:
+        output << "typedef uint8_t CellType;" << endl;
+    break;
+    case 2:
+        output << "typedef uint16_t CellType;" << endl;
+    break;
+    case 4:
+        output << "typedef uint32_t CellType;" << endl;
+    break;
+    case 8:
+        output << "typedef uint64_t CellType;" << endl;
+    break;
+    }
+
+    if (!ptrWrap && hostedTape) {
+        //! The interpreter reports it, so the message and exit code don't depend on where the code runs
+        output << "static void (*hostBounds)(int up);" << endl;
+        output << "void incError() {" << endl;
+        output << "hostBounds(1);" << endl;
+        output << "}" << endl;
+        output << "void decError() {" << endl;
+        output << "hostBounds(0);" << endl;
+        output << "}" << endl;
+    } else if (!ptrWrap) {
+        output << "void incError() {" << endl;
+        output << "fputs(\"Error: Tried to increment pointer beyond upper bound.\\n\", stderr);" << endl;
+        output << "exit(-1);" << endl;
+        output << "}" << endl;
+        output << "void decError() {" << endl;
+        output << "fputs(\"Error: Tried to decrement pointer beyond lower bound.\\n\", stderr);" << endl;
+        output << "exit(-1);" << endl;
+        output << "}" << endl;
+    }
+
+    if (budgeted()) {
+        //! Same as CMemoryBudget, every structure is charged before it grows
+        uint64_t limit = CMemoryBudget::instance().getLimit();
+        output << "typedef struct Account {" << endl;
+        output << "int64_t current;" << endl;
+        output << "int64_t peak;" << endl;
+        output << "} Account;" << endl;
+        output << "Account tapeAccount, stackAccount;" << endl;
+        output << "int64_t memoryTotal, memoryPeak;" << endl;
+        output << "void chargeMemory(Account* account, const char* name, int64_t bytes) {" << endl;
+        output << "memoryTotal += bytes - account->current;" << endl;
+        if (limit != 0) {
+            output << "if (memoryTotal > " << limit << "LL) {" << endl;
+            output << "fprintf(stderr, \"Error: Memory limit of " << limit << " bytes exceeded, the %s needed %lld bytes.\\n\", name, (long long)bytes);" << endl;
+            output << "exit(-1);" << endl;
+            output << "}" << endl;
+        }
+        output << "account->current = bytes;" << endl;
+        output << "if (bytes > account->peak) {" << endl;
+        output << "account->peak = bytes;" << endl;
+        output << "}" << endl;
+        output << "if (memoryTotal > memoryPeak) {" << endl;
+        output << "memoryPeak = memoryTotal;" << endl;
+        output << "}" << endl;
+        output << "}" << endl;
+    }
+
+    if (huge) {
+        output << "const char* hugeMethod = \"none\";" << endl;
+        output << "void backWithHugePages(char* at, size_t bytes) {" << endl;
+        output << "uintptr_t start = ((uintptr_t)at + " << hugePageBytes - 1 << ") & ~(uintptr_t)" << hugePageBytes - 1 << ';' << endl;
+        output << "uintptr_t end = ((uintptr_t)at + bytes) & ~(uintptr_t)" << hugePageBytes - 1 << ';' << endl;
+        output << "void* probe = start < end ? mmap(0, end - start, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0) : MAP_FAILED;" << endl;
+        output << "if (probe != MAP_FAILED) {" << endl;
+        output << "munmap(probe, end - start);" << endl;
+        output << "if (mmap((void*)start, end - start, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) != MAP_FAILED) {" << endl;
+        output << "hugeMethod = \"MAP_HUGETLB\";" << endl;
+        output << "return;" << endl;
+        output << "}" << endl;
+        output << "if (mmap((void*)start, end - start, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) {" << endl;
+        output << "fputs(\"Error: Unable to map the tape!\\n\", stderr);" << endl;
+        output << "exit(-1);" << endl;
+        output << "}" << endl;
+        output << "}" << endl;
+        output << "if (!madvise(at, bytes, MADV_HUGEPAGE)) {" << endl;
+        output << "hugeMethod = \"madvise\";" << endl;
+        output << "}" << endl;
+        output << "}" << endl;
+    }
+
+    if (sparse) {
+        compileSparseTape(output);
+    } else if (staticTape) {
+        //! The program never goes past its footprint, so nothing ever grows and no bounds need checking
+        output << "CellType tapeCells[" << std::max(footprintHigh + 1, (int64_t)initData.size()) - footprintLow << "];" << endl;
+        output << "CellType* allocTape(int64_t size) {" << endl;
+        output << "return tapeCells + " << -footprintLow << ';' << endl;
+        output << "}" << endl;
+        output << "void freeTape(CellType* p) {" << endl;
+        output << "}" << endl;
+    } else if (guardHigh) {
+        //! Same as the interpreter, the tape ends right where a guard starts and faults on it become errors
+        output << "char* tapeRange;" << endl;
+        output << "size_t tapeRangeSize;" << endl;
+        output << "void tapeError() {" << endl;
+        output << "fputs(\"Error: Unable to map the tape!\\n\", stderr);" << endl;
+        output << "exit(-1);" << endl;
+        output << "}" << endl;
+        output << "void guardFault(int sig, siginfo_t* info, void* context) {" << endl;
+        output << "char* address = info->si_addr;" << endl;
+        output << "if (address >= tapeRange && address < tapeRange + " << guardBytes << ") {" << endl;
+        output << "decError();" << endl;
+        output << "} else if (address >= tapeRange && address < tapeRange + tapeRangeSize) {" << endl;
+        output << "incError();" << endl;
+        output << "}" << endl;
+        output << "signal(SIGSEGV, SIG_DFL);" << endl;
+        output << "}" << endl;
+        output << "CellType* allocTape(int64_t size) {" << endl;
+        output << "struct sigaction action;" << endl;
+        output << "size_t bytes = size*sizeof(CellType);" << endl;
+        output << "size_t pages = (bytes + sysconf(_SC_PAGESIZE) - 1) & ~(size_t)(sysconf(_SC_PAGESIZE) - 1);" << endl;
+        if (guardLow) {
+            //! Built for a tape that starts right at the lower guard too
+            output << "if (pages != bytes) {" << endl;
+            output << "tapeError();" << endl;
+            output << "}" << endl;
+        }
+        output << "tapeRangeSize = pages + 2*" << guardBytes << "ULL;" << endl;
+        output << "tapeRange = mmap(0, tapeRangeSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);" << endl;
+        output << "if (tapeRange == MAP_FAILED || mprotect(tapeRange + " << guardBytes << "ULL, pages, PROT_READ | PROT_WRITE)) {" << endl;
+        output << "tapeError();" << endl;
+        output << "}" << endl;
+        if (huge) {
+            output << "backWithHugePages(tapeRange + " << guardBytes << "ULL, pages);" << endl;
+        }
+        output << "memset(&action, 0, sizeof(action));" << endl;
+        output << "action.sa_sigaction = guardFault;" << endl;
+        output << "action.sa_flags = SA_SIGINFO;" << endl;
+        output << "sigaction(SIGSEGV, &action, NULL);" << endl;
+        output << "return (CellType*)(tapeRange + " << guardBytes << "ULL + pages - bytes);" << endl;
+        output << "}" << endl;
+        output << "void freeTape(CellType* p) {" << endl;
+        output << "munmap(tapeRange, tapeRangeSize);" << endl;
+        output << "}" << endl;
+    } else if (dynamic && hostedTape) {
+        //! The interpreter's tape isn't from malloc(), it's grown through a callback instead
+        output << "static void* (*incReallocPtr)(void* p, int64_t* size, int64_t index);" << endl;
+        if (twoWay) {
+            output << "static void* (*decReallocPtr)(void* p, int64_t* low, int64_t index);" << endl;
+        }
+    } else if (dynamic) {
+        //! Same as the interpreter, a big range is reserved and committed bit by bit, it never moves
+        output << "int64_t tapeReserved;" << endl;
+        output << "void tapeError() {" << endl;
+        output << "fputs(\"Error: Out of memory!\\n\", stderr);" << endl;
+        output << "exit(-1);" << endl;
+        output << "}" << endl;
+        output << "CellType* allocTape(int64_t size) {" << endl;
+        output << "void* p = MAP_FAILED;" << endl;
+        output << "tapeReserved = " << tapeReserve/cellSize << ';' << endl;
+        output << "while (tapeReserved > size) {" << endl;
+        output << "p = mmap(0, tapeReserved*sizeof(CellType), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);" << endl;
+        output << "if (p != MAP_FAILED) {" << endl;
+        output << "break;" << endl;
+        output << "}" << endl;
+        output << "tapeReserved /= 2;" << endl;
+        output << "}" << endl;
+        output << "if (p == MAP_FAILED) {" << endl;
+        output << "tapeError();" << endl;
+        output << "}" << endl;
+        if (huge) {
+            output << "if (!madvise(p, tapeReserved*sizeof(CellType), MADV_HUGEPAGE)) {" << endl;
+            output << "hugeMethod = \"madvise\";" << endl;
+            output << "}" << endl;
+        }
+        if (twoWay) {
+            //! Cell 0 sits in the middle, from then on 'tapeReserved' is the room on each side
+            output << "tapeReserved /= 2;" << endl;
+            output << "p = (CellType*)p + tapeReserved;" << endl;
+        }
+        output << "if (mprotect(p, size*sizeof(CellType), PROT_READ | PROT_WRITE)) {" << endl;
+        output << "tapeError();" << endl;
+        output << "}" << endl;
+        output << "return p;" << endl;
+        output << "}" << endl;
+        output << "void freeTape(CellType* p) {" << endl;
+        if (twoWay) {
+            output << "munmap(p - tapeReserved, 2*tapeReserved*sizeof(CellType));" << endl;
+        } else {
+            output << "munmap(p, tapeReserved*sizeof(CellType));" << endl;
+        }
+        output << "}" << endl;
+        output << "void* incReallocPtr(void* p, int64_t* size, int64_t index) {" << endl;
+        output << "int64_t newSize = *size;" << endl;
+        output << "while (newSize <= index) {" << endl;
+        output << "newSize += newSize/2 + 1;" << endl;
+        output << "}" << endl;
+        output << "if (newSize > tapeReserved) {" << endl;
+        output << "newSize = index+1;" << endl;
+        output << "}" << endl;
+        if (budgeted()) {
+            output << "chargeMemory(&tapeAccount, \"tape\", tapeAccount.current + (newSize - *size)*sizeof(CellType));" << endl;
+        }
+        output << "if (newSize > tapeReserved || mprotect(p, newSize*sizeof(CellType), PROT_READ | PROT_WRITE)) {" << endl;
+        output << "tapeError();" << endl;
+        output << "}" << endl;
+        output << "*size = newSize;" << endl;
+        output << "return p;" << endl;
+        output << "}" << endl;
+        if (twoWay) {
+            output << "void* decReallocPtr(void* p, int64_t* low, int64_t index) {" << endl;
+            output << "uintptr_t start;" << endl;
+            output << "int64_t newLow = *low;" << endl;
+            output << "while (index < newLow) {" << endl;
+            output << "newLow += newLow/2 - 1;" << endl;
+            output << "}" << endl;
+            output << "if (-newLow > tapeReserved) {" << endl;
+            output << "newLow = index;" << endl;
+            output << "}" << endl;
+            output << "start = (uintptr_t)((CellType*)p + newLow) & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);" << endl;
+            if (budgeted()) {
+                output << "chargeMemory(&tapeAccount, \"tape\", tapeAccount.current + (int64_t)((uintptr_t)p - start) + *low*(int64_t)sizeof(CellType));" << endl;
+            }
+            output << "if (-newLow > tapeReserved || mprotect((void*)start, (uintptr_t)p - start, PROT_READ | PROT_WRITE)) {" << endl;
+            output << "tapeError();" << endl;
+            output << "}" << endl;
+            output << "*low = ((intptr_t)start - (intptr_t)p)/(intptr_t)sizeof(CellType);" << endl;
+            output << "return p;" << endl;
+            output << "}" << endl;
+        }
+    } else if (mirrored() && !hostedTape) {
+        //! Same as the interpreter, the tape shows up again right before and after itself
+        output << "size_t tapeBytes;" << endl;
+        output << "void tapeError() {" << endl;
+        output << "fputs(\"Error: Unable to map the tape!\\n\", stderr);" << endl;
+        output << "exit(-1);" << endl;
+        output << "}" << endl;
+        output << "CellType* allocTape(int64_t size) {" << endl;
+        output << "char* p;" << endl;
+        output << "int i, fd = memfd_create(\"bfk-tape\", 0);" << endl;
+        output << "tapeBytes = size*sizeof(CellType);" << endl;
+        output << "if (fd < 0 || tapeBytes % sysconf(_SC_PAGESIZE) || ftruncate(fd, tapeBytes)) {" << endl;
+        output << "tapeError();" << endl;
+        output << "}" << endl;
+        output << "p = mmap(0, 3*tapeBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);" << endl;
+        output << "if (p == MAP_FAILED) {" << endl;
+        output << "tapeError();" << endl;
+        output << "}" << endl;
+        output << "for (i = 0; i < 3; i++) {" << endl;
+        output << "if (mmap(p + i*tapeBytes, tapeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {" << endl;
+        output << "tapeError();" << endl;
+        output << "}" << endl;
+        output << "}" << endl;
+        output << "close(fd);" << endl;
+        if (huge) {
+            output << "if (!madvise(p, 3*tapeBytes, MADV_HUGEPAGE)) {" << endl;
+            output << "hugeMethod = \"madvise\";" << endl;
+            output << "}" << endl;
+        }
+        output << "return (CellType*)(p + tapeBytes);" << endl;
+        output << "}" << endl;
+        output << "void freeTape(CellType* p) {" << endl;
+        output << "munmap((char*)p - tapeBytes, 3*tapeBytes);" << endl;
+        output << "}" << endl;
+    } else if (huge) {
+        //! calloc() memory can't be moved over to huge pages, the tape gets a mapping of its own instead
+        output << "size_t tapeBytes;" << endl;
+        output << "CellType* allocTape(int64_t size) {" << endl;
+        output << "char* p;" << endl;
+        output << "tapeBytes = size*sizeof(CellType);" << endl;
+        output << "p = mmap(0, tapeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);" << endl;
+        output << "if (p == MAP_FAILED) {" << endl;
+        output << "return NULL;" << endl;
+        output << "}" << endl;
+        output << "backWithHugePages(p, tapeBytes);" << endl;
+        output << "return (CellType*)p;" << endl;
+        output << "}" << endl;
+        output << "void freeTape(CellType* p) {" << endl;
+        output << "munmap(p, tapeBytes);" << endl;
+        output << "}" << endl;
+    } else if (!hostedTape) {
+        output << "CellType* allocTape(int64_t size) {" << endl;
+        output << "return calloc(size, sizeof(CellType));" << endl;
+        output << "}" << endl;
+        output << "void freeTape(CellType* p) {" << endl;
+        output << "free(p);" << endl;
+        output << "}" << endl;
+    }
+
+    compileStdio(output);
+
+    output << "void getInput(CellType* dst) {" << endl;
+    output << "int temp = getByte();" << endl;
+    output << "if (temp == EOF) {" << endl;
+    switch (eofPolicy)
+    {
+    case RETM1:
+        output << "*dst = -1;" << endl;
+    break;
+    case RET0:
+        output << "*dst = 0;" << endl;
+    break;
+    case NOP:
+    break;
+    case ABORT:
+        if (!hostedTape) {
+            //! Same as the interpreter, what was printed before comes first
+            output << "flushOutput();" << endl;
+        }
+        output << "fputs(\"Error: Encountered EOF while processing input.\", stderr);" << endl;
+        output << "exit(-1);" << endl;
+    break;
+    }
+    output << "} else {" << endl;
+    output << "*dst = (CellType)temp;" << endl;
+    output << "}" << endl;
+    output << "}" << endl;
+
+    if (!initData.empty()) {
+        output << "const CellType datArray[] = { ";
+        for (CellType cell : initData) {
+            output << "0x" << std::hex << cell.c64 << ',';
+        }
+        output << std::dec << " };" << endl;
+    }
+}
+
+void CVanillaState::compileStdio(std::ostream& output)
+{
+    using std::endl;
+
+    if (hostedTape) {
+        //! The interpreter may have read ahead or still hold output, so both go through its own buffers
+        output << "static int (*readInput)(void);" << endl;
+        output << "static void (*hostOutput)(const char*, int64_t);" << endl;
+        output << "void writeOutput(const char* bytes, int64_t count) {" << endl;
+        output << "hostOutput(bytes, count);" << endl;
+        output << "}" << endl;
+        output << "void putOutput(int c) {" << endl;
+        output << "char byte = c;" << endl;
+        output << "hostOutput(&byte, 1);" << endl;
+        output << "}" << endl;
+        output << "void fillOutput(int c, int64_t count) {" << endl;
+        output << "char bytes[256];" << endl;
+        output << "memset(bytes, c, 256);" << endl;
+        output << "for (; count > 0; count -= 256) {" << endl;
+        output << "hostOutput(bytes, count < 256 ? count : 256);" << endl;
+        output << "}" << endl;
+        output << "}" << endl;
+        output << "int getByte(void) {" << endl;
+        output << "return readInput();" << endl;
+        output << "}" << endl;
+        return;
+    }
+
+    //! Same as COutputBuffer and CInputBuffer, stdio would lock and check its stream on every character
+    output << "static unsigned char outBuffer[" << stdioBufferSize << "];" << endl;
+    output << "static size_t outUsed;" << endl;
+    output << "static unsigned char inBuffer[" << stdioBufferSize << "];" << endl;
+    output << "static size_t inNext, inEnd;" << endl;
+    output << "static int inEOF;" << endl;
+
+    output << "void flushOutput(void) {" << endl;
+    output << "size_t done = 0;" << endl;
+    output << "while (done < outUsed) {" << endl;
+    output << "ssize_t written = write(1, outBuffer + done, outUsed - done);" << endl;
+    output << "if (written < 0) {" << endl;
+    output << "if (errno == EINTR) {" << endl;
+    output << "continue;" << endl;
+    output << "}" << endl;
+    output << "break;" << endl;
+    output << "}" << endl;
+    output << "done += written;" << endl;
+    output << "}" << endl;
+    output << "outUsed = 0;" << endl;
+    output << "}" << endl;
+    //! Also runs when exit() is called on an error
+    output << "__attribute__((destructor)) static void flushAtExit(void) {" << endl;
+    output << "flushOutput();" << endl;
+    output << "}" << endl;
+
+    output << "void putOutput(int c) {" << endl;
+    output << "if (outUsed == sizeof(outBuffer)) {" << endl;
+    output << "flushOutput();" << endl;
+    output << "}" << endl;
+    output << "outBuffer[outUsed++] = c;" << endl;
+    if (tuning().lineFlush) {
+        output << "if (c == '\\n') {" << endl;
+        output << "flushOutput();" << endl;
+        output << "}" << endl;
+    }
+    output << "}" << endl;
+
+    output << "void writeOutput(const char* bytes, int64_t count) {" << endl;
+    if (tuning().lineFlush) {
+        output << "while (count-- > 0) {" << endl;
+        output << "putOutput(*bytes++);" << endl;
+        output << "}" << endl;
+    } else {
+        output << "while (count > 0) {" << endl;
+        output << "size_t chunk;" << endl;
+        output << "if (outUsed == sizeof(outBuffer)) {" << endl;
+        output << "flushOutput();" << endl;
+        output << "}" << endl;
+        output << "chunk = sizeof(outBuffer) - outUsed;" << endl;
+        output << "if (chunk > count) {" << endl;
+        output << "chunk = count;" << endl;
+        output << "}" << endl;
+        output << "memcpy(outBuffer + outUsed, bytes, chunk);" << endl;
+        output << "outUsed += chunk;" << endl;
+        output << "bytes += chunk;" << endl;
+        output << "count -= chunk;" << endl;
+        output << "}" << endl;
+    }
+    output << "}" << endl;
+
+    output << "void fillOutput(int c, int64_t count) {" << endl;
+    if (tuning().lineFlush) {
+        output << "while (count-- > 0) {" << endl;
+        output << "putOutput(c);" << endl;
+        output << "}" << endl;
+    } else {
+        output << "while (count > 0) {" << endl;
+        output << "size_t chunk;" << endl;
+        output << "if (outUsed == sizeof(outBuffer)) {" << endl;
+        output << "flushOutput();" << endl;
+        output << "}" << endl;
+        output << "chunk = sizeof(outBuffer) - outUsed;" << endl;
+        output << "if (chunk > count) {" << endl;
+        output << "chunk = count;" << endl;
+        output << "}" << endl;
+        output << "memset(outBuffer + outUsed, c, chunk);" << endl;
+        output << "outUsed += chunk;" << endl;
+        output << "count -= chunk;" << endl;
+        output << "}" << endl;
+    }
+    output << "}" << endl;
+
+    //! Whatever was printed is flushed right before waiting for more input, it may well be a prompt
+    output << "int fillInput(void) {" << endl;
+    output << "ssize_t got;" << endl;
+    output << "if (inEOF) {" << endl;
+    output << "return 0;" << endl;
+    output << "}" << endl;
+    output << "flushOutput();" << endl;
+    output << "do {" << endl;
+    output << "got = read(0, inBuffer, sizeof(inBuffer));" << endl;
+    output << "} while (got < 0 && errno == EINTR);" << endl;
+    output << "if (got <= 0) {" << endl;
+    output << "inEOF = 1;" << endl;
+    output << "return 0;" << endl;
+    output << "}" << endl;
+    output << "inNext = 0;" << endl;
+    output << "inEnd = got;" << endl;
+    output << "return 1;" << endl;
+    output << "}" << endl;
+
+    output << "int getByte(void) {" << endl;
+    output << "if (inNext == inEnd && !fillInput()) {" << endl;
+    output << "return EOF;" << endl;
+    output << "}" << endl;
+    output << "return inBuffer[inNext++];" << endl;
+    output << "}" << endl;
+    output << "int peekByte(void) {" << endl;
+    output << "if (inNext == inEnd && !fillInput()) {" << endl;
+    output << "return EOF;" << endl;
+    output << "}" << endl;
+    output << "return inBuffer[inNext];" << endl;
+    output << "}" << endl;
+
+    //! Same as CVanillaState::feedLoop()
+    output << "CellType feedLoop(CellType cell, unsigned char value, int echo) {" << endl;
+    output << "while (cell != 0 && (inNext < inEnd || fillInput())) {" << endl;
+    output << "unsigned char* bytes = inBuffer + inNext;" << endl;
+    output << "unsigned char* found = memchr(bytes, value, inEnd - inNext);" << endl;
+    output << "size_t used = found ? found - bytes + 1 : inEnd - inNext;" << endl;
+    output << "if (echo) {" << endl;
+    output << "putOutput((unsigned char)(cell + value));" << endl;
+    output << "writeOutput((const char*)bytes, used - 1);" << endl;
+    output << "}" << endl;
+    output << "cell = (unsigned char)(bytes[used - 1] - value);" << endl;
+    output << "inNext += used;" << endl;
+    output << "}" << endl;
+    output << "return cell;" << endl;
+    output << "}" << endl;
+}
+
+void CVanillaState::compileSparseTape(std::ostream& output)
+{
+    using std::endl;
+
+    //! Same layout as CSparseTape, pages are found through a small hash table and the last one used
+    const int pageCells = 1 << CSparseTape::pageShift;
+
+    output << "void tapeError() {" << endl;
+    output << "fputs(\"Error: Out of memory!\\n\", stderr);" << endl;
+    output << "exit(-1);" << endl;
+    output << "}" << endl;
+    output << "typedef struct Page {" << endl;
+    output << "int64_t number;" << endl;
+    output << "struct Page* next;" << endl;
+    output << "CellType cells[" << pageCells << "];" << endl;
+    output << "} Page;" << endl;
+    output << "Page* pageTable[4096];" << endl;
+    output << "Page* lastPage;" << endl;
+    output << "CellType zeroCell;" << endl;
+    output << "CellType* sparseCell(int64_t index, int write) {" << endl;
+    output << "int64_t number = index >> " << CSparseTape::pageShift << ';' << endl;
+    output << "Page* page = lastPage;" << endl;
+    output << "if (!page || page->number != number) {" << endl;
+    output << "page = pageTable[number & 4095];" << endl;
+    output << "while (page && page->number != number) {" << endl;
+    output << "page = page->next;" << endl;
+    output << "}" << endl;
+    output << "if (!page) {" << endl;
+    output << "if (!write) {" << endl;
+    output << "zeroCell = 0;" << endl;
+    output << "return &zeroCell;" << endl;
+    output << "}" << endl;
+    if (budgeted()) {
+        output << "chargeMemory(&tapeAccount, \"tape\", tapeAccount.current + sizeof(Page));" << endl;
+    }
+    output << "page = calloc(1, sizeof(Page));" << endl;
+    output << "if (!page) {" << endl;
+    output << "tapeError();" << endl;
+    output << "}" << endl;
+    output << "page->number = number;" << endl;
+    output << "page->next = pageTable[number & 4095];" << endl;
+    output << "pageTable[number & 4095] = page;" << endl;
+    output << "}" << endl;
+    output << "lastPage = page;" << endl;
+    output << "}" << endl;
+    output << "return &page->cells[index & " << pageCells - 1 << "];" << endl;
+    output << "}" << endl;
+
+    //! 'p' isn't used, only the bounds are kept track of
+    output << "CellType* allocTape(int64_t size) {" << endl;
+    output << "return NULL;" << endl;
+    output << "}" << endl;
+    output << "void freeTape(CellType* p) {" << endl;
+    output << "int i;" << endl;
+    output << "for (i = 0; i < 4096; i++) {" << endl;
+    output << "while (pageTable[i]) {" << endl;
+    output << "Page* next = pageTable[i]->next;" << endl;
+    output << "free(pageTable[i]);" << endl;
+    output << "pageTable[i] = next;" << endl;
+    output << "}" << endl;
+    output << "}" << endl;
+    output << "}" << endl;
+    if (dynamic) {
+        output << "void* incReallocPtr(void* p, int64_t* size, int64_t index) {" << endl;
+        output << "*size = index+1;" << endl;
+        output << "return p;" << endl;
+        output << "}" << endl;
+    }
+    if (twoWay) {
+        output << "void* decReallocPtr(void* p, int64_t* low, int64_t index) {" << endl;
+        output << "*low = index;" << endl;
+        output << "return p;" << endl;
+        output << "}" << endl;
+    }
+}
+
+void CVanillaState::compilePreInst(std::ostream& output)
+{
+    using std::endl;
+    using std::max;
 
-    output << "CellType* p = calloc(" << max(cellCount, (int)initData.size()) << ", sizeof(CellType));" << endl;
-    output << "int index = 0;" << endl;
-    output << "int size = " << max(cellCount, (int)initData.size()) << ';' << endl;
+    int64_t cells = max(staticTape ? footprintHigh + 1 : cellCount, (int64_t)initData.size());
+    if (budgeted() && !sparse) {
+        output << "chargeMemory(&tapeAccount, \"tape\", " << cells - (staticTape ? footprintLow : 0) << "*sizeof(CellType));" << endl;
+    }
+    output << "CellType* p = allocTape(" << cells << ");" << endl;
+    output << "int64_t index = 0;" << endl;
+    output << "int64_t size = " << cells << ';' << endl;
+    if (twoWay) {
+        output << "int64_t low = " << (staticTape ? footprintLow : 0) << ';' << endl;
+    }
 
     if (!initData.empty()) {
         output << "{" << endl;
         output << "int i;" << endl;
         output << "for (i = 0; i < sizeof(datArray)/sizeof(CellType); i++) {" << endl;
-        output << "p[i] = datArray[i];" << endl;
+        if (sparse) {
+            output << "*sparseCell(i, 1) = datArray[i];" << endl;
+        } else {
+            output << "p[i] = datArray[i];" << endl;
+        }
         output << "}" << endl;
         output << "}" << endl;
     }
@@ -436,76 +2641,142 @@ void CVanillaState::compilePreInst(std::ostream& output)
 
 void CVanillaState::compileCleanup(std::ostream& output)
 {
-    output << "free(p);" << std::endl;
+    if (tuning().stats) {
+        output << "flushOutput();" << std::endl;
+        if (!hugePages) {
+            output << "fputs(\"Huge pages: not asked for\\n\", stderr);" << std::endl;
+        } else if (sparse || staticTape) {
+            output << "fputs(\"Huge pages: none\\n\", stderr);" << std::endl;
+        } else {
+            output << "fprintf(stderr, \"Huge pages: %s\\n\", hugeMethod);" << std::endl;
+        }
+        output << "if (stackAccount.peak) {" << std::endl;
+        output << "fprintf(stderr, \"Peak stack: %lld bytes\\n\", (long long)stackAccount.peak);" << std::endl;
+        output << "}" << std::endl;
+        output << "fprintf(stderr, \"Peak tape: %lld bytes\\n\", (long long)tapeAccount.peak);" << std::endl;
+        output << "fprintf(stderr, \"Peak total: %lld bytes";
+        if (CMemoryBudget::instance().getLimit() != 0) {
+            output << " of " << CMemoryBudget::instance().getLimit() << " allowed";
+        }
+        output << "\\n\", (long long)memoryPeak);" << std::endl;
+    }
+    output << "freeTape(p);" << std::endl;
 }
 
 void CVanillaState::runInstruction(const BFinstr& instr)
 {
-    switch (instr.token)
+    switch (instr.op)
     {
-    case '>':
-        curPtrPos += instr.repeat;
+    case OP_ADD:
+    {
+        CellType temp = getCell(curPtrPos + instr.offset);
+        temp.c64 += instr.value;
+        setCell(curPtrPos + instr.offset, temp);
+    }
     break;
-    case '<':
-        curPtrPos -= instr.repeat;
+    case OP_MOVE:
+        curPtrPos += instr.value;
     break;
-    case '+':
+    case OP_SET:
     {
-        CellType temp = getCell(curPtrPos);
-        temp.c64 += instr.repeat;
-        setCell(curPtrPos, temp);
+        CellType temp = { 0 };
+        temp.c64 = instr.value;
+        setCell(curPtrPos + instr.offset, temp);
     }
     break;
-    case '-':
+    case OP_OUT:
     {
-        CellType temp = getCell(curPtrPos);
-        temp.c64 -= instr.repeat;
-        setCell(curPtrPos, temp);
+        CellType temp = getCell(curPtrPos + instr.offset);
+        COutputBuffer::instance().fill(temp.c8, instr.value);
     }
     break;
-    case '.':
+    case OP_IN:
     {
-        CellType temp = getCell(curPtrPos);
-        std::cout.put(temp.c8);
+        CellType temp = getCell(curPtrPos + instr.offset);
+        userInput(temp.c8);
+        setCell(curPtrPos + instr.offset, temp);
     }
     break;
-    case ',':
+    case OP_COPY:
+    case OP_SKIP:
     {
         CellType temp = getCell(curPtrPos);
-        userInput(temp.c8);
+        temp.c8 = feedLoop(temp.c8, instr.value, instr.op == OP_COPY);
         setCell(curPtrPos, temp);
     }
     break;
-    case '[':
+    case OP_SCAN:
+        if (cellSize == 1 && (instr.value == 1 || instr.value == -1) && !ptrWrap && !sparse) {
+            //! getCell() takes care of bounds and growth, the rest is up to memchr
+            while (getCell(curPtrPos).c8 != 0) {
+                uint8_t* cells = (uint8_t*)tape;
+                void* found;
+                if (instr.value == 1) {
+                    found = memchr(cells + curPtrPos, 0, cellCount - curPtrPos);
+                    curPtrPos = found ? (uint8_t*)found - cells : cellCount;
+                } else {
+                    found = memrchr(cells + cellLow, 0, curPtrPos - cellLow + 1);
+                    curPtrPos = found ? (uint8_t*)found - cells : cellLow - 1;
+                }
+            }
+        } else {
+            while (getCell(curPtrPos).c64 != 0) {
+                curPtrPos += instr.value;
+            }
+        }
+    break;
+    case OP_MULADD:
+    {
+        CellType source = getCell(curPtrPos + instr.source);
+        //! Same as the loop it replaces, doesn't touch anything if it wouldn't run
+        if (source.c64 != 0) {
+            CellType temp = getCell(curPtrPos + instr.offset);
+            temp.c64 += source.c64 * instr.value;
+            setCell(curPtrPos + instr.offset, temp);
+        }
+    }
+    break;
+    case OP_OPEN:
         if (getCell(curPtrPos).c64 == 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                ++IP;
-                char token = getCode(IP).token;
-                if (token == '[') {
-                    ++depth;
-                } else if (token == ']') {
-                    --depth;
+            if (instr.jump >= 0) {
+                IP = instr.jump;
+            } else {
+                //! Self-modifying code has no table to use, so scan for the brace instead
+                int depth = 1;
+                //! Make sure the brace it jumps to is the correct one, at the same level
+                while (depth > 0) {
+                    ++IP;
+                    char token = getCode(IP).token;
+                    if (token == '[') {
+                        ++depth;
+                    } else if (token == ']') {
+                        --depth;
+                    }
                 }
             }
         }
     break;
-    case ']':
+    case OP_CLOSE:
         if (getCell(curPtrPos).c64 != 0) {
-            int depth = 1;
-            //! Make sure the brace it jumps to is the correct one, at the same level
-            while (depth > 0) {
-                --IP;
-                char token = getCode(IP).token;
-                if (token == '[') {
-                    --depth;
-                } else if (token == ']') {
-                    ++depth;
+            if (instr.jump >= 0) {
+                IP = instr.jump;
+            } else {
+                int depth = 1;
+                //! Make sure the brace it jumps to is the correct one, at the same level
+                while (depth > 0) {
+                    --IP;
+                    char token = getCode(IP).token;
+                    if (token == '[') {
+                        --depth;
+                    } else if (token == ']') {
+                        ++depth;
+                    }
                 }
             }
         }
     break;
+    default:
+    break;
     }
 
     if (IP + 1 >= instructions.size()) {
@@ -517,14 +2788,68 @@ void CVanillaState::compileInstruction(std::ostream& output, const BFinstr& inst
 {
     using std::endl;
 
-    int repeat = instr.repeat;
-    switch (instr.token)
+    switch (instr.op)
     {
-    case '>':
-        if (ptrWrap) {
-            output << "index = (index + " << repeat << ") % " << cellCount << ';' << endl;
+    case OP_ADD:
+    case OP_SET:
+    case OP_OUT:
+    case OP_IN:
+    case OP_COPY:
+    case OP_SKIP:
+        compileReach(output, instr.offset);
+    break;
+    case OP_MULADD:
+        compileReach(output, instr.source);
+    break;
+    default:
+        //! The pointer may move, or the code may run again from elsewhere
+        reachLow = reachHigh = 0;
+    break;
+    }
+
+    switch (instr.op)
+    {
+    case OP_MOVE:
+        compileMove(output, instr.value);
+    break;
+    case OP_ADD:
+        if (instr.value > 0) {
+            output << cellAt(instr.offset, true) << " += " << instr.value << ';' << endl;
+        } else {
+            output << cellAt(instr.offset, true) << " -= " << -instr.value << ';' << endl;
+        }
+    break;
+    case OP_SET:
+        output << cellAt(instr.offset, true) << " = " << instr.value << ';' << endl;
+    break;
+    case OP_OUT:
+        if (instr.value == 1) {
+            output << "putOutput(" << cellAt(instr.offset) << ");" << endl;
         } else {
-            output << "index += "<< repeat << ';' << endl;
+            output << "fillOutput(" << cellAt(instr.offset) << ", " << instr.value << ");" << endl;
+        }
+    break;
+    case OP_IN:
+        output << "getInput(&" << cellAt(instr.offset, true) << ");" << endl;
+    break;
+    case OP_COPY:
+    case OP_SKIP:
+        //! Only speeds up the loop after it, native code hosted by the interpreter just runs that loop
+        if (!hostedTape) {
+            output << cellAt(0, true) << " = feedLoop(" << cellAt(0) << ", " << instr.value << ", " << (instr.op == OP_COPY) << ");" << endl;
+        }
+    break;
+    case OP_OPEN:
+        output << "while (" << cellAt(0) << ") {" << endl;
+    break;
+    case OP_CLOSE:
+        output << "}" << endl;
+    break;
+    case OP_SCAN:
+        output << "while (" << cellAt(0) << ") {" << endl;
+        if (cellSize == 1 && instr.value == 1 && !ptrWrap && !sparse) {
+            output << "CellType* found = memchr(p + index, 0, size - index);" << endl;
+            output << "index = found ? found - p : size;" << endl;
             output << "if (index >= size) {" << endl;
             if (dynamic) {
                 output << "p = incReallocPtr(p, &size, index);" << endl;
@@ -532,35 +2857,28 @@ void CVanillaState::compileInstruction(std::ostream& output, const BFinstr& inst
                 output << "incError();" << endl;
             }
             output << "}" << endl;
+        } else {
+            compileMove(output, instr.value);
         }
+        output << "}" << endl;
     break;
-    case '<':
-        output << "index -= " << repeat << ';' << endl;
-        output << "if (index < 0) {" << endl;
-        if (ptrWrap) {
-            output << "index = " << cellCount << " + index % " << cellCount << ';' << endl;
+    case OP_MULADD:
+    {
+        //! Same as the loop it replaces, the target is only reached when the source isn't zero
+        int low = reachLow, high = reachHigh;
+        output << "if (" << cellAt(instr.source) << ") {" << endl;
+        compileReach(output, instr.offset);
+        if (instr.value > 0) {
+            output << cellAt(instr.offset, true) << " += " << cellAt(instr.source) << " * " << instr.value << ';' << endl;
         } else {
-            output << "decError();" << endl;
+            output << cellAt(instr.offset, true) << " -= " << cellAt(instr.source) << " * " << -instr.value << ';' << endl;
         }
         output << "}" << endl;
+        reachLow = low;
+        reachHigh = high;
+    }
     break;
-    case '+':
-        output << "p[index] += " << repeat << ';' << endl;
-    break;
-    case '-':
-        output << "p[index] -= " << repeat << ';' << endl;
-    break;
-    case '.':
-        output << "putchar(p[index]);" << endl;
-    break;
-    case ',':
-        output << "getInput(&p[index]);" << endl;
-    break;
-    case '[':
-        output << "while (p[index]) {" << endl;
-    break;
-    case ']':
-        output << "}" << endl;
+    default:
     break;
     }
 
@@ -587,11 +2905,7 @@ void CVanillaState::runDebug()
             cout << "-----------------" << endl;
             cout << "Current IP      : " << IP << endl;
             cout << "Current Pointer : " << curPtrPos << endl;
-            cout << "Next instruction: " << tempCode.token;
-            if (tempCode.repeat > 1) {
-                cout << " x" << tempCode.repeat;
-            }
-            cout << endl;
+            cout << "Next instruction: " << describe(tempCode) << endl;
 
             char choice;
             cout << "What to do ( h ): ";
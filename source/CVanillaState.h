@@ -17,9 +17,21 @@
 #define CVANILLA_STATE_H
 
 #include "IBasicState.h"
+#include "CSparseTape.h"
+#include "CMemoryBudget.h"
+#include "COutputBuffer.h"
+#include "CInputBuffer.h"
+
+#include <atomic>
+
+#include <setjmp.h>
+#include <signal.h>
 
 class CVanillaState : public IBasicState
 {
+    friend class CJitCompiler;
+    friend class CBackgroundCompiler;
+
 public:
     /**
         size        : The size of each cell, acceptable values are 1, 2, 4 or 8
@@ -27,7 +39,7 @@ public:
         wrapPtr     : Wraps the tape pointer around, can't be true if dynamicTape is also true
         dynamicTape : Makes the available tape grow dynamically when accessing out of upper bounds
      */
-    CVanillaState(int size, int count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
+    CVanillaState(int size, int64_t count, bool wrapPtr, bool dynamicTape, ActionOnEOF onEOF, const std::string& dataFile, bool debug);
     ~CVanillaState();
 
     //! Converts BF code to manageable token blocks, compressed/optimized if possible
@@ -37,36 +49,75 @@ public:
     //! Compiles translated code into C source
     void compile(std::ostream& output);
 
+    //! How the tape was laid out and backed
+    void printStats(std::ostream& output) const;
+
 protected:
     void* tape;
 
     int cellSize;
-    int cellCount;
+    int64_t cellCount;
+    int64_t cellLow; //! Lowest cell available, below zero only on a two-way tape
 
     bool ptrWrap;
     bool dynamic;
+    bool twoWay; //! Dynamic tape that also grows to the left, see IBasicState::TapeLayout
+    bool sparse; //! Cells live in 'sparseTape' instead, 'tape' stays empty
+    bool ring;   //! Wrapping tape mapped three times in a row, cells within one tape length of it need no wrapping
+    bool guarded; //! Bounded tape between inaccessible guards, faulting on them stands in for the bounds checks
+    int64_t guardFloor; //! Cells below this still need an explicit check, the lower guard only starts right at cell 0 on a page aligned tape
+    int64_t guardCells; //! How far the pointer may stray past either end before an offset could skip over a guard
+    CSparseTape sparseTape;
+    bool hugePages; //! Huge pages were asked for, see IBasicState::TapeLayout
+    //! What the tape ended up backed by, never more than asked for
+    enum HugeMethod { HUGE_NONE, HUGE_TLB, HUGE_ADVISED } hugeMethod;
 
     ActionOnEOF eofPolicy;
 
-    int curPtrPos; //! Selected memory cell
+    int64_t curPtrPos; //! Selected memory cell
     unsigned IP;   //! Interpretor only, pseudo Instruction Pointer
 
     bool keepRunning;
+    //! Set once background compiled code can take over, see CBackgroundCompiler
+    std::atomic<bool> nativeReady;
+
+    //! Operations of the intermediate representation all variants translate into
+    enum OpCode {
+        OP_NOP,    //! Does nothing, stands for anything that isn't a command
+        OP_ADD,    //! Adds 'value' to the cell at 'offset'
+        OP_MOVE,   //! Moves the pointer by 'value' cells
+        OP_SET,    //! Stores 'value' into the cell at 'offset'
+        OP_OPEN,   //! Skips past 'jump' if the current cell is zero
+        OP_CLOSE,  //! Goes back to 'jump' if the current cell isn't zero
+        OP_IN,     //! Reads a character into the cell at 'offset'
+        OP_OUT,    //! Writes the cell at 'offset' as a character, 'value' times
+        OP_SCAN,   //! Moves the pointer 'value' cells at a time until it finds a zero
+        OP_MULADD, //! Adds the cell at 'source' times 'value' to the cell at 'offset'
+        OP_COPY,   //! Runs the loop after it for as long as input is there, see feedLoop(), prints what it reads
+        OP_SKIP,   //! Same, for a loop that only reads
+        OP_EXT,    //! Variant specific, told apart by 'token'
+        OP_END     //! Stops runCore(), never comes out of translate()
+    };
 
     struct BFinstr
     {
-        char token;
-        int repeat;
+        OpCode op;
+        char token;    //! Symbol it was translated from, 0 for the ones optimize() makes up
+        int offset;    //! Cell it works on, relative to the pointer
+        int source;    //! Cell OP_MULADD reads, relative to the pointer
+        int64_t value; //! Operand, or how many times a variant specific command repeats
+        int jump;      //! Index of the matching brace, -1 if unresolved
 
-        BFinstr(char t): token(t), repeat(1) {}
-        void incr() { ++repeat; }
+        //! Decodes the vanilla commands, anything else becomes OP_EXT
+        explicit BFinstr(char t);
+        BFinstr(char t, OpCode o, int64_t v = 1): op(o), token(t), offset(0), source(0), value(v), jump(-1) {}
     };
     std::vector<BFinstr> instructions;
 
     std::vector<CellType> initData;
 
-    const CellType getCell(int cellIndex);
-    void setCell(int cellIndex, const CellType& newValue);
+    const CellType getCell(int64_t cellIndex);
+    void setCell(int64_t cellIndex, const CellType& newValue);
 
     //! Understands escape sequences, symbol, octal and hex
     //! Only hex values can be > 255( technically, octal too but not for much )
@@ -74,7 +125,144 @@ protected:
 
     bool userInput(uint8_t& c);
 
-    void examineIndex(int& cellIndex);
+    //! Pushes onto a variant's own stack, growing it against the memory budget
+    void pushStack(std::vector<CellType>& stack, const CellType& value);
+
+    void examineIndex(int64_t& cellIndex);
+
+    //! The tape is an anonymous mapping, the kernel hands out zeroed pages as they're first touched
+    //! so a huge tape only costs what's actually used
+    void allocTape(int64_t count);
+    //! Changes the amount of cells, new ones read as zero and old ones keep their values
+    void resizeTape(int64_t count);
+    //! Makes cells from 'low' up to zero available too, only on a two-way tape
+    void lowerTape(int64_t low);
+    void freeTape();
+    //! Cells from 0 up to this were touched at some point, going by which pages are resident, -1 if that can't be told
+    int64_t touchedCells() const;
+    //! Maps the same memory before, at and after 'tape', false if the system won't or the size isn't page aligned
+    bool mapRing(int64_t count);
+    //! Puts the tape between guards, its end right against the upper one, false if the address space isn't there
+    bool mapGuarded(int64_t count);
+    //! Moves the pages from 'at' on over to huge pages, or at least asks the kernel to, quietly giving up if neither works
+    //! Only for memory that's already readable and writable, MAP_HUGETLB would commit it all at once otherwise
+    void backWithHugePages(void* at, size_t bytes);
+    void* tapeStart;   //! Where the tape's mapping begins, guards, mirrors and reserved room included
+    size_t tapeMapped; //! Bytes of address space the tape holds, committed or not
+    //! How far the tape can grow on each side, a two-way tape starts in the middle of its range
+    size_t tapeRoom() const {
+        return twoWay ? tapeMapped/2 : tapeMapped;
+    }
+    //! Whether generated C can index past either end of the tape and land on the right cell
+    //! Not when the data file makes it allocate more cells than the tape has
+    bool mirrored() const {
+        return ring && (int64_t)initData.size() <= cellCount;
+    }
+
+    //! Address space a dynamic tape reserves up front, in bytes
+    static const int64_t tapeReserve = (int64_t)1 << 40;
+    //! Size of each guard, in bytes, enough that no single offset can reach past one
+    static const int64_t guardBytes = (int64_t)1 << 36;
+    //! The default huge page size of MAP_HUGETLB on x86-64
+    static const int64_t hugePageBytes = (int64_t)1 << 21;
+
+    //! Where a fault on a guard jumps back to, in runCore()
+    sigjmp_buf guardJump;
+    //! Turns a fault on the guards into a jump to 'guardJump', anything else crashes as usual
+    static void guardFault(int, siginfo_t* info, void*);
+    static CVanillaState* guardOwner; //! Whose guards guardFault() checks against
+
+    //! Appends an instruction, folding it into the previous one when they add up
+    void pushInstr(const BFinstr& instr);
+    //! Runs the optimization passes the tuning level asks for
+    //! Only for variants whose loops, ADD and MOVE behave exactly like vanilla
+    void optimize();
+    //! Replaces common loops( clear, scan, multiply/copy ) with single instructions
+    void replaceIdioms();
+    //! Turns pointer movement inside a block into offsets, with one move at its end
+    void foldMoves();
+    //! Puts OP_COPY or OP_SKIP before loops like ",[.,]", ",[,]" or ",----------[++++++++++.,----------]"
+    //! Only for single byte cells, where reading a character sets the whole cell
+    void replaceInputLoops();
+    //! Does what the loop after an OP_COPY/OP_SKIP would, for as long as input is there without waiting for EOF
+    //! Each round reads a character and leaves it minus 'value' in the cell, OP_COPY also prints the cell plus 'value' first
+    //! Returns the cell, the loop itself then ends or deals with EOF as usual
+    uint8_t feedLoop(uint8_t cell, uint8_t value, bool echo);
+    //! Pairs every 'open' with its 'close' once, so loops don't have to rescan the code
+    void linkJumps(char open, char close);
+
+    //! What a loop does with the pointer, as far as can be told without running it
+    struct LoopSpan
+    {
+        bool balanced; //! Every iteration ends where it started, so the cells it touches are known up front
+        int64_t low;   //! Lowest cell it can touch, relative to where it starts
+        int64_t high;  //! Highest one
+    };
+    std::vector<LoopSpan> loopSpans; //! One per instruction, only meaningful for OP_OPEN
+    //! Works out loopSpans, only for code whose instructions behave exactly like vanilla
+    void analyzeLoops();
+    //! Cells the code from 'begin' up to 'end' touches relative to where it starts, and where it leaves the pointer
+    //! False if that can't be told, inner loops have to be in loopSpans already
+    bool measureSpan(unsigned begin, unsigned end, LoopSpan& span, int64_t& shift) const;
+    //! Works out the footprint of the program from 'begin' on, with the pointer at 'pointer' there, after analyzeLoops()
+    void measureFootprint(unsigned begin = 0, int64_t pointer = 0);
+    //! Whether every cell the program can touch is known, without it going out of bounds or wrapping around
+    //! A dynamic tape may still have to grow to cover it
+    bool footprintKnown;
+    int64_t footprintLow, footprintHigh;
+    //! Set by compile(), generated C gets a fixed array of just the footprint and no checks at all
+    bool staticTape;
+    //! Biggest footprint that goes into a fixed array, past that the mapped tapes are just as cheap
+    static const int64_t staticTapeBytes = (int64_t)1 << 26;
+    //! Runs the program from the start for as long as it needs no input and stays on the tape it starts with
+    //! Leaves the cells, the pointer and whatever got printed, returns the top level instruction the rest starts at
+    //! Stops before 'stopAt' at the latest, without touching any of the instructions it doesn't finish
+    unsigned evaluatePrefix(unsigned stopAt, std::vector<CellType>& cells, int64_t& pointer, std::string& printed) const;
+    //! How much of that is worth doing at compile time, and baking into generated C
+    static const uint64_t evaluateSteps = (uint64_t)1 << 24;
+    static const int64_t evaluateBytes = (int64_t)1 << 20;
+    //! Whether a balanced loop starting at 'index' stays on the tape, growing it first if it can
+    template <typename Tape>
+    bool coversLoop(int64_t index, const LoopSpan& span);
+
+    //! Readable form of an instruction, for the debugger
+    static std::string describe(const BFinstr& instr);
+
+    //! Generated C for the cell at 'offset' from the pointer
+    //! 'write' only matters for a sparse tape, reading a missing page doesn't create it
+    std::string cellAt(int offset, bool write = false) const;
+    //! Emits 'text' as a C string literal, a line at a time
+    static void compileString(std::ostream& output, const std::string& text);
+    //! Emits C that moves the pointer by 'amount', checking bounds as needed
+    void compileMove(std::ostream& output, int64_t amount);
+    //! Emits C that makes sure the cell at 'offset' from the pointer can be accessed
+    void compileReach(std::ostream& output, int offset);
+    //! Emits the instructions from 'begin' up to 'end', checking the tape once for each balanced loop
+    void compileBlock(std::ostream& output, unsigned begin, unsigned end);
+    //! A balanced loop, without any checks inside when the tape is known to cover it
+    void compileBalanced(std::ostream& output, unsigned open);
+    bool unchecked; //! Set while compileBalanced() emits code that needs no checks
+    //! Offsets already known to be reachable since the pointer last moved
+    int reachLow, reachHigh;
+    //! Set by compilePreMain(), which ends of the tape generated C leaves to guard pages
+    bool guardHigh, guardLow;
+
+    //! Compiles translated code into a C function that can start from any loop
+    void compileResumable(std::ostream& output);
+    //! Set while compileResumable() runs, the tape then belongs to the interpreter and only it may grow it
+    //! and bounds errors are left to it to report
+    bool hostedTape;
+    //! Whether generated C keeps count of its memory itself, for --max-memory or --stats
+    //! Not with a hosted tape, the interpreter does that then
+    bool budgeted() const {
+        return !hostedTape && (CMemoryBudget::instance().getLimit() != 0 || tuning().stats);
+    }
+
+    //! Emits the paged tape generated C uses when 'sparse' is set
+    void compileSparseTape(std::ostream& output);
+    //! Buffered putOutput(), fillOutput(), writeOutput() and getByte() for generated code, instead of stdio
+    void compileStdio(std::ostream& output);
+    static const int64_t stdioBufferSize = (int64_t)1 << 16;
 
     virtual void compilePreMain(std::ostream& output);
     virtual void compilePreInst(std::ostream& output);
@@ -88,6 +276,49 @@ protected:
     virtual bool hasInstructions() const {
         return !instructions.empty();
     }
+    //! Whether the loop starting at the given instruction has to stay a loop instead of becoming an idiom, for variants that jump into loops
+    virtual bool keepsLoop(size_t) const {
+        return false;
+    }
+    //! Whether repeats of the given variant command add up into one instruction, as translate() folds them
+    virtual bool foldsToken(char) const {
+        return false;
+    }
+    //! Whether run() may use a specialized core, false for anything that changes how instructions run
+    virtual bool hasPlainRuntime() const {
+        return true;
+    }
+
+    //! Interpreter loop specialized for one cell type, tape mode and action on EOF
+    template <typename Cell, typename Tape, ActionOnEOF onEOF>
+    void runCore();
+    //! The loop itself, kept out of runCore() so sigsetjmp() there doesn't get in the way of its registers
+    struct Threaded;
+    template <typename Cell, typename Tape, ActionOnEOF onEOF>
+#ifdef __GNUC__
+    __attribute__((noinline))
+#endif
+    void runThreaded(std::vector<Threaded>& decoded);
+
+    //! Tape modes runCore() is specialized for
+    template <typename Policy>
+    struct ContiguousTape;
+    struct BoundedTape;
+    struct WrappedTape;
+    struct RingTape;
+    struct GuardedTape;
+    struct DynamicTape;
+    struct TwoWayTape;
+    struct SparseTape;
+
+    typedef void (CVanillaState::*Core)();
+    Core core; //! Picked once by the constructor, according to the options
+
+    static Core pickCore(int size, bool wrapPtr, bool dynamicTape, bool twoWayTape, bool sparseTape, bool ringTape, bool guardedTape, ActionOnEOF onEOF);
+    template <typename Cell>
+    static Core pickTape(bool wrapPtr, bool dynamicTape, bool twoWayTape, bool sparseTape, bool ringTape, bool guardedTape, ActionOnEOF onEOF);
+    template <typename Cell, typename Tape>
+    static Core pickEOF(ActionOnEOF onEOF);
 
     virtual void runDebug();
 
@@ -33,6 +33,39 @@ class IBasicState
 public:
     enum ActionOnEOF { RETM1, RET0, NOP, ABORT };
 
+    //! Knobs that change how a program gets executed, but never what it does
+    struct Tuning
+    {
+        int optLevel; //! 0 disables every optimization pass
+        bool jit;        //! Runs vanilla code as native code instead of interpreting it
+        bool background; //! Compiles with gcc while interpreting, switches over once done
+        bool compileRun; //! Compiles with gcc first, then runs the result in-process
+        bool stats;      //! Reports on stderr how the run went, generated programs do so too
+        bool lineFlush;  //! Generated programs flush their output at every newline, for interactive use
+
+        Tuning(): optLevel(2), jit(false), background(false), compileRun(false), stats(false), lineFlush(false) {}
+    };
+    //! Shared by every state, has to be set up before constructing one
+    static Tuning& tuning() {
+        static Tuning instance;
+        return instance;
+    }
+
+    //! How the tape is laid out, for the variants that keep it in CVanillaState
+    struct TapeLayout
+    {
+        bool twoWay; //! Grows to the left of cell 0 too, instead of stopping there
+        bool sparse; //! Keeps cells in pages made on first write, for programs that use far apart cells
+        bool hugePages; //! Backs the tape with huge pages where the system has them, fewer TLB misses on big tapes
+
+        TapeLayout(): twoWay(false), sparse(false), hugePages(false) {}
+    };
+    //! Same as tuning(), set up before constructing a state
+    static TapeLayout& tapeLayout() {
+        static TapeLayout instance;
+        return instance;
+    }
+
     virtual ~IBasicState() {}
 
     virtual void translate(std::istream& input) = 0;
@@ -43,6 +76,9 @@ public:
         return false;
     }
 
+    //! What tuning().stats prints after run()
+    virtual void printStats(std::ostream&) const {}
+
 protected:
     union CellType
     {
@@ -42,6 +42,9 @@
 #include "CExtLollerState.h"
 #include "CDrawState.h"
 
+#include "CBuildCache.h"
+#include "CMemoryBudget.h"
+
 #define VERSION "0.9.0"
 
 using namespace std;
@@ -49,7 +52,7 @@ using namespace std;
 enum LangVariants { VANILLA, EXTENDED, EXTENDED2, EXTENDED3, LOVE, STACKED, BCD, STUCK, JUMP,
                     DOLLAR, SELFMOD, CARET, BITCHAN, COMPRESSED, LOLLER, EXTLOLLER, DRAW };
 
-const char shortOptions[] = "hvs:t:wye:co:d:ijx::b";
+const char shortOptions[] = "hvs:t:wye:co:d:ijx::bO:";
 
 const option longOptions[] = {
     { "help",         no_argument,       0, 'h' },
@@ -64,14 +67,25 @@ const option longOptions[] = {
     { "data",         required_argument, 0, 'd' },
     { "stdin",        no_argument,       0, 'i' },
     { "debug",        no_argument,       0, 'b' },
+    { "optimize",     required_argument, 0, 'O' },
     { "lang",         required_argument, 0, 256 },
+    { "jit",          no_argument,       0, 257 },
+    { "background-compile", no_argument, 0, 258 },
+    { "no-cache",     no_argument,       0, 259 },
+    { "compile-run",  no_argument,       0, 260 },
+    { "two-way-tape", no_argument,       0, 261 },
+    { "sparse-tape",  no_argument,       0, 262 },
+    { "hugepages",    no_argument,       0, 263 },
+    { "stats",        no_argument,       0, 264 },
+    { "max-memory",   required_argument, 0, 265 },
+    { "line-flush",   no_argument,       0, 266 },
     { 0, 0, 0, 0 }
 };
 
 int main(int argc, char* argv[])
 {
     int cellSize = 1;
-    int cellCount = 32768; //! More than 30k, aligned for possible optimization when compiling BF code
+    int64_t cellCount = 32768; //! More than 30k, aligned for possible optimization when compiling BF code
     bool wrapPtr = false;
     bool dynamic = false;
     bool debug = false;
@@ -80,6 +94,7 @@ int main(int argc, char* argv[])
     IBasicState::ActionOnEOF onEOF = IBasicState::RETM1;
 
     bool compile = false;
+    bool useCache = true;
     string output_file = "a.out";
     string input_file = "";
     string dataFile = "";
@@ -108,6 +123,9 @@ int main(int argc, char* argv[])
             cout << "  -t X, --tape-size=X   ; Sets amount of available cells (Default=32768)" << endl;
             cout << "  -w, --wrap-pointer    ; Confines the memory pointer between bounds" << endl;
             cout << "  -y, --dynamic-tape    ; Makes the \'tape\' grow dynamically, without limit" << endl;
+            cout << "  --two-way-tape        ; Like -y, but the \'tape\' also grows left of the first cell" << endl;
+            cout << "  --sparse-tape         ; Keeps the \'tape\' in pages made on first write, for far apart cells" << endl;
+            cout << "  --hugepages           ; Backs the \'tape\' with huge pages if possible, for very big tapes" << endl;
             cout << "  -e X, --eof-action=X  ; Changes the default behavior when managing EOF" << endl;
             cout << "        -1              ; Returns -1 to the program (Default)" << endl;
             cout << "        0               ; Returns 0 to the program" << endl;
@@ -115,7 +133,18 @@ int main(int argc, char* argv[])
             cout << "        abort           ; Quits execution with an error message" << endl;
             cout << "  -c, --compile         ; Compiles BF code into native binary, if possible" << endl;
             cout << "  -o X, --output=X      ; For compiling only (Default=\"a.out\")" << endl;
+            cout << "  --no-cache            ; For compiling only, always runs the compiler instead of reusing a binary" << endl;
+            cout << "  --line-flush          ; For compiling only, the program flushes its output at every newline" << endl;
             cout << "  -d X, --data=X        ; Memory initialization data( ASCII file )" << endl;
+            cout << "  -O X, --optimize=X    ; Sets optimization level (Default=2)" << endl;
+            cout << "        0               ; Only merges consecutive commands" << endl;
+            cout << "        1               ; Also replaces clear, scan and multiply loops" << endl;
+            cout << "        2               ; Also folds pointer movement into offsets" << endl;
+            cout << "  --jit                 ; Runs vanilla code as x86-64 machine code, without calling a compiler" << endl;
+            cout << "  --compile-run         ; Compiles to native code in memory and runs it, leaving no files behind" << endl;
+            cout << "  --background-compile  ; Interprets while gcc builds native code, then switches to it" << endl;
+            cout << "  --stats               ; Prints how the \'tape\' was set up and used once done, on stderr" << endl;
+            cout << "  --max-memory=X        ; Stops with an error once the \'tape\' and stacks need more than X bytes, K/M/G suffixes work" << endl;
             cout << "  -i, --stdin           ; Take code input from standard input instead" << endl;
             cout << "  -j, --lang=jump       ; Uses \'JumpFuck\' instead of vanilla" << endl;
             cout << "  -x [N], --lang=ext[N] ; Uses \'Extended Brainfuck Type N\' instead of vanilla" << endl;
@@ -179,6 +208,11 @@ int main(int argc, char* argv[])
         case 'c':
             compile = true;
         break;
+        case 'O':
+            if (!(stringstream(optarg) >> IBasicState::tuning().optLevel)) {
+                cerr << "Warning: Can't understand optimization level, ignoring it." << endl;
+            }
+        break;
         case 'o':
             if (output_file != "a.out") {
                 cerr << "Warning: Output file was set more than once. Ignoring previous value." << endl;
@@ -261,6 +295,62 @@ int main(int argc, char* argv[])
             }
         }
         break;
+        case 257:
+            IBasicState::tuning().jit = true;
+        break;
+        case 258:
+            IBasicState::tuning().background = true;
+        break;
+        case 259:
+            useCache = false;
+        break;
+        case 260:
+            IBasicState::tuning().compileRun = true;
+        break;
+        case 261:
+            IBasicState::tapeLayout().twoWay = true;
+            dynamic = true;
+        break;
+        case 262:
+            IBasicState::tapeLayout().sparse = true;
+        break;
+        case 263:
+            IBasicState::tapeLayout().hugePages = true;
+        break;
+        case 264:
+            IBasicState::tuning().stats = true;
+        break;
+        case 266:
+            IBasicState::tuning().lineFlush = true;
+        break;
+        case 265:
+        {
+            uint64_t bytes = 0;
+            char unit = 0;
+            stringstream input(optarg);
+            if (!(input >> bytes)) {
+                cerr << "Warning: Can't understand memory limit, ignoring it." << endl;
+                break;
+            }
+            input >> unit;
+            switch (unit)
+            {
+            case 'K':
+            case 'k':
+                bytes <<= 10;
+            break;
+            case 'M':
+            case 'm':
+                bytes <<= 20;
+            break;
+            case 'G':
+            case 'g':
+                bytes <<= 30;
+            break;
+            }
+            CMemoryBudget::instance().setLimit(bytes);
+        }
+        break;
         case '?':
         break;
         }
@@ -278,6 +368,11 @@ int main(int argc, char* argv[])
     try {
         IBasicState* myBF;
 
+        if (IBasicState::tapeLayout().sparse && useVariant != VANILLA && useVariant != CARET) {
+            cerr << "Warning: Sparse tape ignored, only vanilla and Brainfuck^ support it." << endl;
+            IBasicState::tapeLayout().sparse = false;
+        }
+
         switch (useVariant)
         {
         case VANILLA:
@@ -335,6 +430,10 @@ int main(int argc, char* argv[])
             myBF = new CCaretState(cellSize, cellCount, wrapPtr, dynamic, onEOF, dataFile, debug);
         break;
         case BITCHAN:
+            if (IBasicState::tapeLayout().twoWay) {
+                cerr << "Warning: Two-way tape ignored." << endl;
+                IBasicState::tapeLayout().twoWay = false;
+            }
             myBF = new CBitchanState(cellCount, wrapPtr, dynamic, dataFile, debug);
             if (cellSize != 1) {
                 cerr << "Warning: Custom cell size ignored." << endl;
@@ -383,24 +482,41 @@ int main(int argc, char* argv[])
         }
 
         if (compile) {
-            string tempFile = output_file+".c";
-            ofstream outputStream(tempFile);
-            if (!outputStream.is_open()) {
-                throw runtime_error("Unable to open "+tempFile+" for writing.");
-            }
-            myBF->compile(outputStream);
-            outputStream.close();
+            const string compiler = "gcc -O3 -s";
+
+            ostringstream code;
+            myBF->compile(code);
+
+            //! The generated code already depends on every option that matters, so it makes a good key
+            CBuildCache cache(useCache ? compiler + '\n' + code.str() : string());
+            if (!cache.fetch(output_file)) {
+                string tempFile = output_file+".c";
+                ofstream outputStream(tempFile);
+                if (!outputStream.is_open()) {
+                    throw runtime_error("Unable to open "+tempFile+" for writing.");
+                }
+                outputStream << code.str();
+                outputStream.close();
+
+                if (system((compiler+" -o "+output_file+" "+tempFile).c_str()) != 0) {
+                    throw runtime_error("Wasn't able to compile requested code.");
+                }
+                remove(tempFile.c_str());
 
-            if (system(("gcc -O3 -s -o "+output_file+" "+tempFile).c_str()) != 0) {
-                throw runtime_error("Wasn't able to compile requested code.");
+                cache.store(output_file);
             }
-            remove(tempFile.c_str());
         } else {
             myBF->run();
+            COutputBuffer::instance().flush();
+            if (IBasicState::tuning().stats) {
+                myBF->printStats(cerr);
+            }
         }
 
         delete myBF;
     } catch (exception& e) {
+        //! Whatever the program printed before failing still comes first
+        COutputBuffer::instance().flush();
         cerr << "Error: " << e.what() << endl;
         return EXIT_FAILURE;
     }
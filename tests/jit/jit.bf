@@ -0,0 +1,9 @@
+Multiply loop fills two cells with 70
+++++++++++++++[->+++++>+++++<<]
+>-----.>----.
+Odd step on a wrapping cell: 1 needs 171 turns of minus 3
+[-]+[--->+<]>--------------------------------------------------------------------------------------------------------.
+Scan loops in both directions
+<<[<]>.[>]>.
+,+[-.,+]
+